@@ -182,3 +182,37 @@ will let the left LED blink violett. It does not matter if there is code inserte
  @warning As of now these only work with position less then 256.
 */
 
+
+/** @example THR/YLD THR starts a second program part at the given position which runs at the same time as the first one.
+Both parts share the registers. Every part runs until it waits (WAI) or gives way to the others (YLD). Up to 4 parts can run at once. \n
+The code: \n
+THR 5   \n
+LD1 V   \n
+WAI 5   \n
+LD1 A   \n
+WAI 5   \n
+JUM 1   \n
+will let the left LED blink violett while the code starting at position 5 is executed,
+e.g. the example of BEG/END checking the first button.
+*/
+
+/** @example PRS/WFP PRS is a condition which is true if the given button has been pressed since the last PRS or WFP
+for this button, so even short presses are not missed. WFP waits until the given button is pressed. \n
+The code: \n
+WFP 0   \n
+LD1 G   \n
+WFP 0   \n
+LD1 A   \n
+JUM 0   \n
+will switch the left LED on and off with every press of the first button.
+*/
+
+/** @example CHN The EEPROM holds 4 programs (slots 0-3). F2 switches to the next slot while programming, F3 names the slot
+with the typed characters, and holding button 1-4 while switching into executing mode runs slot 0-3.
+CHN ends all program parts and continues with the first instruction of the given slot, keeping the registers. \n
+The code in slot 0: \n
+PIC R0  \n
+INC 1   \n
+CHN 1   \n
+counts R0 up and continues with slot 1, which can show R0 and chain back with CHN 0.
+*/
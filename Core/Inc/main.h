@@ -59,6 +59,7 @@ void Error_Handler(void);
 /* Private defines -----------------------------------------------------------*/
 #define ModeSwitch_Pin GPIO_PIN_13
 #define ModeSwitch_GPIO_Port GPIOC
+#define ModeSwitch_EXTI_IRQn EXTI4_15_IRQn
 #define Summer_Pin GPIO_PIN_7
 #define Summer_GPIO_Port GPIOA
 #define Button4_Pin GPIO_PIN_12
@@ -51,7 +51,9 @@ void HardFault_Handler(void);
 void SVC_Handler(void);
 void PendSV_Handler(void);
 void SysTick_Handler(void);
+void DMA1_Channel2_3_IRQHandler(void);
 void EXTI4_15_IRQHandler(void);
+void I2C1_IRQHandler(void);
 void TIM14_IRQHandler(void);
 /* USER CODE BEGIN EFP */
 
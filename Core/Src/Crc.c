@@ -0,0 +1,36 @@
+/**
+ * @file Crc.c
+ * @brief Implementation of the checksums with the CRC unit
+ */
+
+#include "main.h"
+#include "Crc.h"
+
+//Documented in .h
+void Crc_Init(void)
+{
+	__HAL_RCC_CRC_CLK_ENABLE();
+}
+
+//Documented in .h
+void Crc_Start(void)
+{
+	//The reset loads the initial value, the input and output are not reversed
+	CRC->CR = CRC_CR_RESET;
+}
+
+//Documented in .h
+void Crc_Add(const uint8_t *data, uint16_t size)
+{
+	//A byte written to the data register is processed in one AHB cycle, so words don't have to be assembled
+	for(uint16_t i = 0; i < size; i++)
+	{
+		*(__IO uint8_t*)&CRC->DR = data[i];
+	}
+}
+
+//Documented in .h
+uint32_t Crc_Get(void)
+{
+	return CRC->DR;
+}
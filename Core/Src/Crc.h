@@ -0,0 +1,40 @@
+/**
+ * @file Crc.h
+ * @brief Calculates CRC-32 checksums with the CRC unit of the STM32F0
+ * @details Uses the fixed polynomial 0x04C11DB7 with the initial value 0xFFFFFFFF, without reversing the input or
+ * the output (CRC-32/MPEG-2). The bytes are fed in the order they are stored in memory.
+ * The host simulator calculates the same values in software (see Simulator/Src/SimCrc.c).
+ */
+
+#ifndef SRC_CRC_H_
+#define SRC_CRC_H_
+#include <stdint.h>
+
+/**
+  * @brief Enables the clock of the CRC unit
+  * @details Must be called once before any other function of this file.
+  */
+void Crc_Init(void);
+
+
+/**
+  * @brief Starts a new checksum
+  */
+void Crc_Start(void);
+
+
+/**
+  * @brief Adds bytes to the checksum
+  * @param data The bytes
+  * @param size Number of bytes
+  */
+void Crc_Add(const uint8_t *data, uint16_t size);
+
+
+/**
+  * @brief Returns the checksum of all bytes added since Crc_Start()
+  */
+uint32_t Crc_Get(void);
+
+
+#endif /* SRC_CRC_H_ */
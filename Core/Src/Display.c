@@ -6,70 +6,250 @@
 #include "Font.h"
 #include "Display.h"
 #include "STM_FUNCTIONS.h"
+#include "I2CBus.h"
 #include "main.h"
+#include<stdbool.h>
 #include<stdint.h>
+#include<string.h>
 
 /**
-  *	@brief I2C object created by HAL
+  *	@brief I2C-address of the display
   */
-extern I2C_HandleTypeDef hi2c1;
+uint16_t addr = 0x3C;
 
 /**
-  *	@brief I2C-address of the display
+  *	@brief Number of pages (rows of 8 pixels) of the display
   */
-uint16_t addr = 0x3C;
+#define DISPLAY_PAGES 4
+
+/**
+  *	@brief Number of columns of the display
+  */
+#define DISPLAY_COLUMNS 128
+
+/**
+  *	@brief Control byte followed by commands
+  */
+#define DISPLAY_CONTROL_COMMANDS 0x00
+
+/**
+  *	@brief Control byte followed by pixel data
+  */
+#define DISPLAY_CONTROL_DATA 0x40
+
+/**
+  *	@brief Columns of a page that differ from the memory of the display (first > last if the page is up to date)
+  */
+typedef struct {
+	uint8_t first;
+	uint8_t last;
+} Display_Span;
+
+/**
+  *	@brief Copy of the memory of the display, which is drawn into and sent to the display by Display_Flush()
+  */
+static uint8_t frame[DISPLAY_PAGES][DISPLAY_COLUMNS];
+
+/**
+  *	@brief Changed columns of each page of frame[]
+  */
+static Display_Span dirty[DISPLAY_PAGES];
+
+/**
+  *	@brief Columns of each page of frame[] that are being sent to the display and must not be drawn into
+  */
+static volatile Display_Span sending[DISPLAY_PAGES];
 
 /**
-  * @brief Writes one or more commands to the display
-  * @details Can be used to initialize the display, set the cursor or set brightness
+  *	@brief Jobs of the flush running in the background (see Display_SubmitFlush())
+  */
+static struct {
+	volatile uint8_t remaining;					///< Number of pages in sending[] whose data has not been sent
+	volatile bool pending;						///< Display_Flush() has been called while running, the changes are sent afterwards
+	I2CBus_Job windowJobs[DISPLAY_PAGES];		///< Address window of each run of pages (at the index of its first page)
+	I2CBus_Job dataJobs[DISPLAY_PAGES];			///< Changed columns of each page
+	uint8_t windows[DISPLAY_PAGES][6];			///< Commands setting the address windows
+} flush;
+
+/**
+  * @brief Writes one or more commands to the display in a single transfer
+  * @details Can be used to initialize the display, set the address window or set brightness
   * @param pCommands[] List of commands
   * @param pSize Size of pCommands[] in bytes
   */
 static void Display_WriteCommands(uint8_t pCommands[], uint16_t pSize)
 {
-	uint8_t buffer[2];
-	buffer[0] = 0x00;  // Control byte for command
-	for(uint16_t i = 0; i < pSize; i++)
+	I2CBus_Transmit(I2CBUS_DISPLAY_COMMAND, addr, DISPLAY_CONTROL_COMMANDS, pCommands, pSize);
+}
+
+/**
+  * @brief Marks columns of a page as changed
+  * @param page The page
+  * @param first First changed column
+  * @param last Last changed column
+  */
+static void Display_MarkDirty(uint8_t page, uint8_t first, uint8_t last)
+{
+	if(dirty[page].first > dirty[page].last)
 	{
-		buffer[1] = pCommands[i];
-		HAL_I2C_Master_Transmit (&hi2c1, 0x3C << 1, buffer, sizeof(buffer), 10000);
+		dirty[page].first = first;
+		dirty[page].last = last;
+		return;
 	}
+	if(first < dirty[page].first)
+		dirty[page].first = first;
+	if(last > dirty[page].last)
+		dirty[page].last = last;
 }
 
+/**
+  * @brief Writes a byte into the framebuffer, the column is only marked as changed if its pixels differ
+  * @param page Page of the byte
+  * @param x Column of the byte
+  * @param data The 8 pixels of the column
+  */
+static void Display_SetByte(uint8_t page, uint8_t x, uint8_t data)
+{
+	if(page >= DISPLAY_PAGES || x >= DISPLAY_COLUMNS || frame[page][x] == data)
+		return;
 
-//Documented in .h
-void Display_SetCursor(uint8_t x, uint8_t page)
+	//A column being sent keeps its pixels until its transfer has finished
+	__disable_irq();
+	while(x >= sending[page].first && x <= sending[page].last)
+	{
+		__enable_irq();
+		I2CBus_Wait(&flush.dataJobs[page]);
+		__disable_irq();
+	}
+	frame[page][x] = data;
+	Display_MarkDirty(page, x, x);
+	__enable_irq();
+}
+
+/**
+  * @brief Fills and submits a job for the display
+  * @param job The job
+  * @param caller I2CBUS_DISPLAY_COMMAND or I2CBUS_DISPLAY_DATA
+  * @param control Control byte sent before the bytes
+  * @param data Bytes to be sent
+  * @param size Number of bytes
+  * @param done Function called when the job has finished (NULL = none)
+  */
+static void Display_SubmitJob(I2CBus_Job *job, I2CBus_Caller_t caller, uint8_t control, uint8_t *data, uint16_t size, I2CBus_Callback done)
 {
-	uint8_t com[] = {(0xB0 | (page & 0x07)),(0x00 | (x & 0x0F)),(0x10 | ((x >> 4) & 0x0F))};
-	Display_WriteCommands(com, sizeof(com));
+	job->caller = caller;
+	job->operation = I2CBUS_TRANSMIT;
+	job->devAddress = addr;
+	job->address = control;
+	job->data = data;
+	job->size = size;
+	job->done = done;
+	I2CBus_Submit(job);
 }
 
-//Documented in .h
-void Display_SetContrast(uint8_t value)
+/**
+  * @brief Hands the changed columns over to the flush and submits its jobs
+  * @details Each run of changed pages with the same columns gets one address window followed by one data job per page.
+  * Whole pages lie behind each other in the framebuffer, so the bus sends their data in a single transfer.
+  * @warning The flush must not be running
+  */
+static void Display_SubmitFlush(void);
+
+/**
+  * @brief Called by the I2C bus when the data of a page has been sent, so the page can be drawn into again
+  * @param job The data job of the page
+  */
+static void Display_PageSent(I2CBus_Job *job)
 {
-	uint8_t buffer[] =
+	uint8_t page = job - flush.dataJobs;
+
+	//The columns of a failed transfer are sent by the next flush
+	if(job->status != HAL_OK)
+		Display_MarkDirty(page, sending[page].first, sending[page].last);
+	sending[page].first = DISPLAY_COLUMNS;
+	sending[page].last = 0;
+
+	//Changes made while the flush was running are sent afterwards
+	if(--flush.remaining == 0 && flush.pending)
+		Display_SubmitFlush();
+}
+
+//Documented above
+static void Display_SubmitFlush(void)
+{
+	uint8_t count = 0;
+	for(uint8_t page = 0; page < DISPLAY_PAGES; page++)
 	{
-	0x00,	  // Control byte for command
-	0x81,
-	value
-	};
+		sending[page].first = dirty[page].first;
+		sending[page].last = dirty[page].last;
+		dirty[page].first = DISPLAY_COLUMNS;
+		dirty[page].last = 0;
+		if(sending[page].first <= sending[page].last)
+			count++;
+	}
+	flush.pending = false;
+	flush.remaining = count;
+
+	for(uint8_t page = 0; page < DISPLAY_PAGES; page++)
+	{
+		uint8_t first = sending[page].first;
+		uint8_t last = sending[page].last;
+		if(first > last)
+			continue;
+
+		uint8_t lastPage = page;
+		while(lastPage + 1 < DISPLAY_PAGES && sending[lastPage + 1].first == first && sending[lastPage + 1].last == last)
+		{
+			lastPage++;
+		}
+
+		uint8_t *window = flush.windows[page];
+		window[0] = 0x21;
+		window[1] = first;
+		window[2] = last;
+		window[3] = 0x22;
+		window[4] = page;
+		window[5] = lastPage;
+		Display_SubmitJob(&flush.windowJobs[page], I2CBUS_DISPLAY_COMMAND, DISPLAY_CONTROL_COMMANDS, window, 6, NULL);
 
-	HAL_I2C_Master_Transmit (&hi2c1, 0x3C << 1, buffer, sizeof(buffer), 10000);
+		for(; page <= lastPage; page++)
+		{
+			Display_SubmitJob(&flush.dataJobs[page], I2CBUS_DISPLAY_DATA, DISPLAY_CONTROL_DATA, &frame[page][first], last - first + 1, Display_PageSent);
+		}
+		page = lastPage;
+	}
 }
 
-/**
-  * @brief Writes a byte of data to the display (The display automatically increments the cursor psoition)
-  * @param data Byte of data that is sent to the Display
-  */
-static void Display_WriteData(uint8_t data)
+//Documented in .h
+void Display_Flush(void)
 {
-    uint8_t buffer[2]=
+	__disable_irq();
+	bool start = flush.remaining == 0;
+	if(!start)
+		flush.pending = true;
+	__enable_irq();
+
+	if(start)
+		Display_SubmitFlush();
+}
+
+//Documented in .h
+void Display_WaitForFlush(void)
+{
+	while(flush.remaining > 0)
 	{
-    0x40, // Control byte for data
-    data
-	};
+		for(uint8_t page = 0; page < DISPLAY_PAGES; page++)
+		{
+			I2CBus_Wait(&flush.dataJobs[page]);
+		}
+	}
+}
 
-    HAL_I2C_Master_Transmit (&hi2c1, 0x3C << 1, buffer, sizeof(buffer), 10000);
+//Documented in .h
+void Display_SetContrast(uint8_t value)
+{
+	uint8_t commands[] = {0x81, value};
+	Display_WriteCommands(commands, sizeof(commands));
 }
 
 //Documented in .h
@@ -85,25 +265,26 @@ void Display_Init()
 
 	Display_WriteCommands(initCommands, sizeof(initCommands));
 
-    Display_FillBlack();
-
+	//The memory of the display is undefined after power-up
+	memset(frame, 0, sizeof(frame));
+	for(uint8_t page = 0; page < DISPLAY_PAGES; page++)
+	{
+		Display_MarkDirty(page, 0, DISPLAY_COLUMNS - 1);
+	}
+	Display_Flush();
 }
 
 //Documented in .h
 void Display_FillBlack(void)
 {
-	uint8_t commands[]=
+	for(uint8_t page = 0; page < DISPLAY_PAGES; page++)
 	{
-			0x20,0x00,0x21,0x00,0x7F,0x22,0x00,0x03
-	};
-
-	Display_WriteCommands(commands, sizeof(commands));
-
-    for (uint16_t i = 0; i < 512; i++)
-    {
-        Display_WriteData(0x00);
-    }
-
+		for(uint8_t x = 0; x < DISPLAY_COLUMNS; x++)
+		{
+			Display_SetByte(page, x, 0x00);
+		}
+	}
+	Display_Flush();
 }
 
 
@@ -125,37 +306,37 @@ const char leftArrow[8] =
 //Documented in .h
 void Display_LeftArrow(uint8_t line)
 {
-    for(uint8_t j = 0; j < 4; j++)
+    for(uint8_t j = 0; j < DISPLAY_PAGES; j++)
     {
-        Display_SetCursor(112,j);
         for(uint8_t i = 0; i < 8; i++)
         {
-            Display_WriteData(0x00);
+            Display_SetByte(j, 112 + i, j == line ? leftArrow[i] : 0x00);
         }
     }
-    Display_SetCursor(112,line);
+    Display_Flush();
+}
+
+/**
+  * @brief Draws a single character into the framebuffer
+  * @param ch Character to be drawn
+  * @param pos Horizontal position of the character
+  * @param line Line of the character
+  */
+static void Display_DrawCharacter(char ch, uint8_t pos, uint8_t line)
+{
+	if(ch == 0) ch = ' ';
     for(uint8_t i = 0; i < 8; i++)
     {
-        Display_WriteData(leftArrow[i]);
+        Display_SetByte(line, pos*8 + i, display_font[(ch-32)*8 + i]);
+        Display_SetByte(line+1, pos*8 + i, display_font[(ch+63)*8 + i]);
     }
 }
 
-
 //Documented in .h
 void Display_WriteCharacter(char ch, uint8_t pos, uint8_t line)
 {
-	if(ch == 0) ch = ' ';
-    Display_SetCursor(pos*8,line);
-    for(uint16_t i = (ch-32)*8; i < (ch-31)*8; i++)
-    {
-        Display_WriteData(display_font[i]);
-    }
-
-    Display_SetCursor(pos*8,line+1);
-    for(uint16_t i = (ch+63)*8; i < (ch+64)*8; i++)
-    {
-        Display_WriteData(display_font[i]);
-    }
+	Display_DrawCharacter(ch, pos, line);
+	Display_Flush();
 }
 
 //Documented in .h
@@ -170,8 +351,9 @@ void Display_WriteString(char str[], uint8_t size, uint8_t pos, uint8_t line)
 		}
 		if(str[j] == 0) str[j] = ' ';
 
-		Display_WriteCharacter(str[j],pos+j,line);
+		Display_DrawCharacter(str[j],pos+j,line);
 	}
+	Display_Flush();
 }
 
 
@@ -243,8 +425,170 @@ void Display_ShowErrorMessage(int line)
 	Display_FillBlack();
 	Display_WriteString(letters1, sizeof(letters1), 3, 0);
     Display_WriteString(letters2, sizeof(letters2), 3, 2);
+	HAL_Delay(500);
 	while(!isProgrammingMode());
 }
 
 
 
+
+
+//Documented in .h
+void Display_ShowFaultyLines(const uint16_t lines[], uint8_t count)
+{
+	char letters1[] =
+	{
+			'F','E','H','L','E','R',' ','I','N',' ','Z','E','I','L','E'
+	};
+
+	uint8_t first = 0;
+	while(!isProgrammingMode())
+	{
+		char letters2[16];
+		for(uint8_t i = 0; i < 4; i++)
+		{
+			if(first + i < count)
+				STM_Number3ToChar(lines[first + i], &letters2[i*4]);
+			else
+				letters2[i*4] = letters2[i*4+1] = letters2[i*4+2] = ' ';
+			letters2[i*4+3] = ' ';
+		}
+
+		Display_FillBlack();
+		Display_WriteString(letters1, sizeof(letters1), 0, 0);
+		Display_WriteString(letters2, sizeof(letters2), 0, 2);
+
+		if(count <= 4)
+		{
+			HAL_Delay(500);
+			while(!isProgrammingMode());
+			return;
+		}
+
+		//Show the next four lines every second
+		for(uint8_t i = 0; i < 100 && !isProgrammingMode(); i++)
+		{
+			HAL_Delay(10);
+		}
+		first = (first + 4 < count) ? first + 4 : 0;
+	}
+}
+
+//Documented in .h
+void Display_ShowSlot(uint8_t slot, const char name[3])
+{
+	char letters1[] =
+	{
+			'P','R','O','G','R','A','M','M',' ',(char)('0' + slot)
+	};
+	char letters2[] =
+	{
+			name[0],name[1],name[2]
+	};
+
+	Display_FillBlack();
+	Display_WriteString(letters1, sizeof(letters1), 3, 0);
+	Display_WriteString(letters2, sizeof(letters2), 6, 2);
+	HAL_Delay(500);
+
+	Display_FillBlack();
+}
+
+//Documented in .h
+void Display_ShowMemoryFullMessage(void)
+{
+	char letters[] =
+	{
+			'S','P','E','I','C','H','E','R',' ','V','O','L','L'
+	};
+
+	Display_FillBlack();
+	Display_WriteString(letters, sizeof(letters), 2, 1);
+	HAL_Delay(500);
+
+	Display_FillBlack();
+}
+
+//Documented in .h
+void Display_ShowProgramTooLongMessage(void)
+{
+	char letters1[] =
+	{
+			'A','L','T','E','S',' ','P','R','O','G','R','A','M','M'
+	};
+	char letters2[] =
+	{
+			'Z','U',' ','L','A','N','G'
+	};
+
+	Display_FillBlack();
+	Display_WriteString(letters1, sizeof(letters1), 1, 0);
+	Display_WriteString(letters2, sizeof(letters2), 4, 2);
+	HAL_Delay(500);
+
+	Display_FillBlack();
+}
+
+/**
+  * @brief Writes a number as decimal digits into a char-array (numbers too large are shown as 999...)
+  * @param num The number to be converted
+  * @param out The array in which to write the digits
+  * @param digits Number of digits
+  */
+static void Display_NumberToChars(uint32_t num, char out[], uint8_t digits)
+{
+	uint32_t limit = 1;
+	for(uint8_t i = 0; i < digits; i++)
+	{
+		limit *= 10;
+	}
+	if(num >= limit)
+		num = limit - 1;
+
+	for(int8_t i = digits - 1; i >= 0; i--)
+	{
+		out[i] = '0' + num % 10;
+		num /= 10;
+	}
+}
+
+/**
+  *	@brief Names of the callers of the I2C bus as shown by Display_ShowBusStatistics() (in the order of I2CBus_Caller_t)
+  */
+static const char busCallerNames[I2CBus_Caller_t_MAX][8] =
+{
+		{'E','E',' ','L','E','S','E','N'},
+		{'E','E',' ','S','C','H','R','.'},
+		{'D','I','S','P',' ','B','E','F'},
+		{'D','I','S','P',' ','D','A','T'}
+};
+
+//Documented in .h
+void Display_ShowBusStatistics(void)
+{
+	static uint8_t caller = 0;
+	const I2CBus_Statistics *statistics = I2CBus_GetStatistics(caller);
+
+	char line1[16];
+	char line2[16];
+	for(uint8_t i = 0; i < 8; i++)
+	{
+		line1[i] = busCallerNames[caller][i];
+	}
+	line1[8] = ' ';
+	Display_NumberToChars(statistics->blockingTime / 1000, &line1[9], 5);
+	line1[14] = 'M';
+	line1[15] = 'S';
+
+	line2[0] = 'T';
+	Display_NumberToChars(statistics->transactions, &line2[1], 6);
+	line2[7] = ' ';
+	line2[8] = 'B';
+	Display_NumberToChars(statistics->bytes, &line2[9], 7);
+
+	Display_FillBlack();
+	Display_WriteString(line1, sizeof(line1), 0, 0);
+	Display_WriteString(line2, sizeof(line2), 0, 2);
+
+	caller = (caller + 1) % I2CBus_Caller_t_MAX;
+}
@@ -1,6 +1,8 @@
 /**
  * @file Display.h
  * @brief Provides functions for the use of the OLED-display to other files
+ * @details The functions draw into a framebuffer in RAM (128x32 pixels, 512 bytes) and only send the columns whose
+ * pixels have changed to the display in the background (see Display_Flush()).
  */
 
 
@@ -10,11 +12,19 @@
 
 
 /**
-  * @brief Sets position of the cursor
-  * @param x Horizontal position of the cursor
-  * @param page Selected line
+  * @brief Starts sending the changed parts of the framebuffer to the display in the background
+  * @details Is called by every function drawing onto the display. Each run of changed columns of a page is sent as
+  * one transfer after the address window has been set, pages with the same changed columns share one window.
+  * The transfers are queued on the I2C bus (see I2CBus.h), so the function returns at once. Drawing only waits if it
+  * changes a column that is still being sent. If a flush is already running, the changes are sent when it has finished.
   */
-void Display_SetCursor(uint8_t x, uint8_t page);
+void Display_Flush(void);
+
+
+/**
+  * @brief Waits until all changes have been sent to the display
+  */
+void Display_WaitForFlush(void);
 
 
 
@@ -86,10 +96,45 @@ void Display_ShowTerminatedMessage();
 
 /**
   * @brief 	Shows a message stating that an error has occured and provides the line of code the error occured in
+  * @details In executing mode the message is shown until the device is switched into programming mode,
+  * in programming mode it is shown for half a second.
   * @param 	line Line of Code the error occured in
   */
 void Display_ShowErrorMessage(int line);
 
+/**
+  * @brief 	Shows the lines of all faulty instructions found when the program was checked
+  * @details Up to four lines are shown at once, more lines are shown four at a time changing every second.
+  * The message is shown until the device is switched into programming mode.
+  * @param 	lines Positions of the faulty instructions
+  * @param 	count Number of faulty instructions
+  */
+void Display_ShowFaultyLines(const uint16_t lines[], uint8_t count);
+
+/**
+  * @brief 	Shows the selected program slot and its name for half a second
+  * @param 	slot The slot (see ProgramStore_SelectSlot())
+  * @param 	name The 3 characters of the slot's name
+  */
+void Display_ShowSlot(uint8_t slot, const char name[3]);
+
+/**
+  * @brief 	Shows for half a second that a line could not be stored because the EEPROM is full
+  */
+void Display_ShowMemoryFullMessage(void);
+
+/**
+  * @brief 	Shows for half a second that the program of the old layout is too long to be converted (see ProgramStore_Load())
+  */
+void Display_ShowProgramTooLongMessage(void);
+
+/**
+  * @brief 	Shows the usage of the I2C bus by one of its callers (see I2CBus.h)
+  * @details The upper line shows the caller and the time spent on the bus (in ms), the lower line the number
+  * of transactions (T) and bytes (B). Every call shows the next caller.
+  */
+void Display_ShowBusStatistics(void);
+
 
 
 #endif
@@ -7,88 +7,82 @@
 #include "InstructionList.h"
 #include "STM_FUNCTIONS.h"
 #include "EEPROM.h"
+#include "I2CBus.h"
 
 /**
- * @brief I2C object generated by HAL
+ * @brief I2C address of the EEPROM
  */
-extern I2C_HandleTypeDef hi2c1;
+#define EEPROM_ADDRESS 0x50
 
 /**
-  * @brief Reads one byte from the EEPROM
-  * @param address Address of the byte
-  * @return The byte at the given address
-  */
-static uint8_t EEPROM_ReadByte(uint16_t address)
-{
-	uint8_t data;
-
-	HAL_I2C_Mem_Read(&hi2c1,
-	                 0x50 << 1,
-	                 address,
-	                 I2C_MEMADD_SIZE_16BIT,
-	                 &data,
-	                 1,
-	                 HAL_MAX_DELAY);
-
-	return data;
-}
+ * @brief Read started by EEPROM_StartReadBytes()
+ */
+static I2CBus_Job readJob;
 
 /**
-  * @brief Writes one byte to the EEPROM
-  * @param address Address to write the byte at
-  * @param data The byte to be written
+  * @brief Writes bytes inside one EEPROM page using a single write cycle
+  * @details Returns once the bytes have been sent, the next access waits for the end of the write cycle (see I2CBus.h).
+  * @param address Address of the first byte
+  * @param data The bytes to be written
+  * @param size Number of bytes (must not cross the end of the page)
   */
-static void EEPROM_WriteByte(uint16_t address, uint8_t data)
+static void EEPROM_WritePage(uint16_t address, uint8_t *data, uint16_t size)
 {
+	I2CBus_MemWrite(I2CBUS_EEPROM_WRITE, EEPROM_ADDRESS, address, data, size);
+}
 
-	HAL_I2C_Mem_Write(&hi2c1,
-	                  0x50 << 1,
-	                  address,
-	                  I2C_MEMADD_SIZE_16BIT,
-	                  &data,
-	                  1,
-	                  HAL_MAX_DELAY);
+//Documented in .h
+void EEPROM_WriteBytes(uint16_t address, uint8_t *data, uint16_t size)
+{
+	while(size > 0)
+	{
+		uint16_t chunk = EEPROM_PAGE_SIZE - address % EEPROM_PAGE_SIZE;
+		if(chunk > size)
+			chunk = size;
 
-	while (HAL_I2C_IsDeviceReady(&hi2c1, 0x50 << 1, 1, HAL_MAX_DELAY) != HAL_OK);
+		EEPROM_WritePage(address, data, chunk);
+		address += chunk;
+		data += chunk;
+		size -= chunk;
+	}
 }
 
-
 //Documented in .h
-Instruction EEPROM_GetInstruction(int position)
+void EEPROM_ReadBytes(uint16_t address, uint8_t *data, uint16_t size)
 {
-	position = position*4;
-	Instruction in;
-	in.functionNumber = EEPROM_ReadByte(position);
-	in.data = EEPROM_ReadByte(position+1);
-	in.data2 = EEPROM_ReadByte(position+2);
-	in.data3 = EEPROM_ReadByte(position+3);
-	return in;
+	I2CBus_MemRead(I2CBUS_EEPROM_READ, EEPROM_ADDRESS, address, data, size);
 }
 
 //Documented in .h
-uint8_t EEPROM_GetFunctionNumber(int position)
+bool EEPROM_StartReadBytes(uint16_t address, uint8_t *data, uint16_t size)
 {
-	position = position*4;
-	return(EEPROM_ReadByte(position));
+	if(readJob.busy)
+		return false;
+
+	readJob.caller = I2CBUS_EEPROM_READ;
+	readJob.operation = I2CBUS_MEM_READ;
+	readJob.devAddress = EEPROM_ADDRESS;
+	readJob.address = address;
+	readJob.data = data;
+	readJob.size = size;
+	I2CBus_Submit(&readJob);
+	return true;
 }
 
 //Documented in .h
-void EEPROM_PutInstruction(Instruction in, int position)
+void EEPROM_WaitForRead(void)
 {
-	position = position*4;
-	EEPROM_WriteByte(position, in.functionNumber);
-	EEPROM_WriteByte(position+1, in.data);
-	EEPROM_WriteByte(position+2, in.data2);
-	EEPROM_WriteByte(position+3, in.data3);
+	I2CBus_Wait(&readJob);
 }
 
 
 //Documented in .h
 void EEPROM_EraseAll()
 {
-	for(int i = 0; i <= 0xFFF; i++)
+	uint8_t zeros[EEPROM_PAGE_SIZE] = {0};
+	for(uint16_t i = 0; i < EEPROM_SIZE; i += EEPROM_PAGE_SIZE)
 	{
-		EEPROM_WriteByte(i,0);
+		EEPROM_WritePage(i, zeros, EEPROM_PAGE_SIZE);
 	}
 }
 
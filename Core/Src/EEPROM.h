@@ -6,39 +6,58 @@
 
 #ifndef SRC_EEPROM_H_
 #define SRC_EEPROM_H_
+#include<stdbool.h>
 #include<stdint.h>
 #include"main.h"
 #include"Instruction.h"
 
+/**
+ * @brief Size of the EEPROM in bytes
+ */
+#define EEPROM_SIZE 0x1000
+
+/**
+ * @brief Size of one EEPROM page in bytes
+ * @details Sequential reads within a page are served by the EEPROM without re-addressing.
+ */
+#define EEPROM_PAGE_SIZE 32
+
+
+/**
+  * @brief Reads a block of consecutive bytes from the EEPROM using a single sequential read
+  * @param address Address of the first byte
+  * @param data Buffer the bytes are written to
+  * @param size Number of bytes to be read
+  */
+void EEPROM_ReadBytes(uint16_t address, uint8_t *data, uint16_t size);
+
 
 /**
-  * @brief Reads an instruction from the EEPROM
-  * @details 0 equals the first Instruction 1 the seconds and so on.
-  Even though the instructions take up 4 bytes of space this is accounted for inside the function
-  * @param position Position of the instruction
-  * @return Read instruction
+  * @brief Starts reading a block of consecutive bytes from the EEPROM in the background (DMA)
+  * @details The read is queued with the priority of the instruction fetches (see I2CBus.h).
+  * The buffer must not be used until EEPROM_WaitForRead() has returned.
+  * @param address Address of the first byte
+  * @param data Buffer the bytes are written to
+  * @param size Number of bytes to be read
+  * @return false if another background read has not finished yet, in which case nothing is started
   */
-Instruction EEPROM_GetInstruction(int position);
+bool EEPROM_StartReadBytes(uint16_t address, uint8_t *data, uint16_t size);
 
 
 /**
-  * @brief Reads the function number of an instruction in the EEPROM
-  * @details Position 0 equals the first instruction, 1 the seconds and so on.
-  Even though the instructions take up 4 bytes of space this is accounted for inside the function
-  * @param position Position of the instruction
-  * @return Function number of the instruction
+  * @brief Waits until the read started by EEPROM_StartReadBytes() has finished
   */
-uint8_t EEPROM_GetFunctionNumber(int position);
+void EEPROM_WaitForRead(void);
 
 
 /**
-  * @brief Writes an instruction into EEPROM at the given position
-  * @details Position 0 equals the first instruction, 1 the seconds and so on.
-  Even though the instructions take up 4 bytes of space this is accounted for inside the function
-  * @param in The instruction to be written
-  * @param position The position at which to write the Instruction.
+  * @brief Writes a block of consecutive bytes into the EEPROM
+  * @details The block is split at the page boundaries, so every page takes a single write cycle.
+  * @param address Address of the first byte
+  * @param data The bytes to be written
+  * @param size Number of bytes to be written
   */
-void EEPROM_PutInstruction(Instruction in, int position);
+void EEPROM_WriteBytes(uint16_t address, uint8_t *data, uint16_t size);
 
 
 /**
@@ -0,0 +1,334 @@
+/**
+ * @file I2CBus.c
+ * @brief Implementation of the queue of jobs on the I2C bus
+ */
+
+#include <stddef.h>
+#include "main.h"
+#include "I2CBus.h"
+#include "STM_FUNCTIONS.h"
+
+/**
+ * @brief Time (in us) between two polls of a device that is busy with a write cycle
+ */
+#define I2CBUS_POLL_INTERVAL 500
+
+/**
+ * @brief I2C object generated by HAL
+ */
+extern I2C_HandleTypeDef hi2c1;
+
+/**
+ * @brief Priority of the jobs of each caller (lower values are started first)
+ */
+static const uint8_t priorities[I2CBus_Caller_t_MAX] = {0, 2, 1, 1};
+
+/**
+ * @brief Usage of the I2C bus by each caller
+ */
+static I2CBus_Statistics statistics[I2CBus_Caller_t_MAX];
+
+/**
+ * @brief Queued jobs sorted by priority
+ */
+static I2CBus_Job *volatile queue;
+
+/**
+ * @brief Job being transferred, followed by the jobs sent in the same transfer (NULL if the bus is free)
+ */
+static I2CBus_Job *volatile current;
+
+/**
+ * @brief Placeholder for current while a busy device is polled
+ */
+static I2CBus_Job polling;
+
+/**
+ * @brief 7 bit address of the device busy with a write cycle (0 = none)
+ */
+static volatile uint8_t busyDevice;
+
+/**
+ * @brief Time (in us) of the next poll of busyDevice
+ */
+static volatile uint32_t nextPoll;
+
+/**
+ * @brief Number of bytes of the transfer of current (including the combined jobs)
+ */
+static uint16_t currentSize;
+
+
+/**
+  * @brief Takes the first queued job out of the queue if it continues the last job of a transfer
+  * @details Writes to the EEPROM are never combined, since they must not cross the end of an EEPROM page.
+  * @param last Last job of the transfer, the combined job is linked to it
+  * @return true if the job has been combined
+  * @warning The interrupts must be disabled
+  */
+static bool I2CBus_Combine(I2CBus_Job *last)
+{
+	I2CBus_Job *following = queue;
+	if(following == NULL || following->devAddress != last->devAddress || following->operation != last->operation
+			|| last->operation == I2CBUS_MEM_WRITE || following->data != last->data + last->size
+			|| (uint32_t)currentSize + following->size > UINT16_MAX)
+		return false;
+	if(following->address != (last->operation == I2CBUS_MEM_READ ? last->address + last->size : last->address))
+		return false;
+
+	queue = following->next;
+	following->next = NULL;
+	last->next = following;
+	currentSize += following->size;
+	return true;
+}
+
+/**
+  * @brief Takes the first job that doesn't wait for a busy device out of the queue
+  * @return The job or NULL
+  * @warning The interrupts must be disabled
+  */
+static I2CBus_Job* I2CBus_Take(void)
+{
+	I2CBus_Job *volatile *link = &queue;
+	while(*link != NULL && (*link)->devAddress == busyDevice)
+	{
+		link = &(*link)->next;
+	}
+
+	I2CBus_Job *job = *link;
+	if(job != NULL)
+	{
+		*link = job->next;
+		job->next = NULL;
+	}
+	return job;
+}
+
+/**
+  * @brief Starts the next job if the bus is free
+  */
+static void I2CBus_StartNext(void);
+
+/**
+  * @brief Ends the transfer of the current job and calls the callbacks of its jobs
+  * @param status Result of the transfer
+  */
+static void I2CBus_Finish(HAL_StatusTypeDef status)
+{
+	I2CBus_Job *job = current;
+	if(job == NULL || job == &polling)
+		return;
+
+	if(job->operation == I2CBUS_MEM_WRITE && status == HAL_OK)
+	{
+		busyDevice = job->devAddress;
+		nextPoll = STM_GetMicros() + I2CBUS_POLL_INTERVAL;
+	}
+	current = NULL;
+
+	while(job != NULL)
+	{
+		I2CBus_Job *following = job->next;
+		job->next = NULL;
+		job->status = status;
+		job->busy = false;
+		if(job->done != NULL)
+			job->done(job);
+		job = following;
+	}
+
+	I2CBus_StartNext();
+}
+
+//Documented above
+static void I2CBus_StartNext(void)
+{
+	__disable_irq();
+	if(current != NULL)
+	{
+		__enable_irq();
+		return;
+	}
+	I2CBus_Job *job = I2CBus_Take();
+	if(job == NULL)
+	{
+		__enable_irq();
+		return;
+	}
+	currentSize = job->size;
+	for(I2CBus_Job *last = job; I2CBus_Combine(last); last = last->next);
+	current = job;
+	__enable_irq();
+
+	//The bytes are accounted to the caller of each job, the transfer and the address to the first one
+	statistics[job->caller].transactions++;
+	statistics[job->caller].bytes += job->operation == I2CBUS_TRANSMIT ? 1 : 2;
+	for(I2CBus_Job *combined = job; combined != NULL; combined = combined->next)
+	{
+		statistics[combined->caller].bytes += combined->size;
+	}
+
+	HAL_StatusTypeDef status;
+	switch(job->operation)
+	{
+		case I2CBUS_MEM_READ:
+			status = HAL_I2C_Mem_Read_DMA(&hi2c1, job->devAddress << 1, job->address, I2C_MEMADD_SIZE_16BIT, job->data, currentSize);
+			break;
+		case I2CBUS_MEM_WRITE:
+			status = HAL_I2C_Mem_Write_DMA(&hi2c1, job->devAddress << 1, job->address, I2C_MEMADD_SIZE_16BIT, job->data, currentSize);
+			break;
+		default:
+			//The control byte is sent like the address of a memory with 8 bit addresses, so the data needs no copy
+			status = HAL_I2C_Mem_Write_DMA(&hi2c1, job->devAddress << 1, job->address, I2C_MEMADD_SIZE_8BIT, job->data, currentSize);
+			break;
+	}
+	if(status != HAL_OK)
+		I2CBus_Finish(status);
+}
+
+/**
+  * @brief Called by HAL when a read has finished
+  * @param hi2c The I2C handle
+  */
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+	I2CBus_Finish(HAL_OK);
+}
+
+/**
+  * @brief Called by HAL when a write has finished
+  * @param hi2c The I2C handle
+  */
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+	I2CBus_Finish(HAL_OK);
+}
+
+/**
+  * @brief Called by HAL when a transfer has failed
+  * @param hi2c The I2C handle
+  */
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+	I2CBus_Finish(HAL_ERROR);
+}
+
+//Documented in .h
+void I2CBus_Submit(I2CBus_Job *job)
+{
+	job->busy = true;
+	job->next = NULL;
+
+	__disable_irq();
+	I2CBus_Job *volatile *link = &queue;
+	while(*link != NULL && priorities[(*link)->caller] <= priorities[job->caller])
+	{
+		link = &(*link)->next;
+	}
+	job->next = *link;
+	*link = job;
+	__enable_irq();
+
+	I2CBus_StartNext();
+}
+
+//Documented in .h
+void I2CBus_Process(void)
+{
+	if(HAL_I2C_GetState(&hi2c1) != HAL_I2C_STATE_READY)
+		return;
+
+	if(busyDevice != 0 && (int32_t)(STM_GetMicros() - nextPoll) >= 0)
+	{
+		__disable_irq();
+		bool free = current == NULL;
+		if(free)
+			current = &polling;
+		__enable_irq();
+
+		//A single address byte, the bus is not occupied while the device is busy
+		if(free)
+		{
+			if(HAL_I2C_IsDeviceReady(&hi2c1, busyDevice << 1, 1, 1) == HAL_OK)
+				busyDevice = 0;
+			else
+				nextPoll = STM_GetMicros() + I2CBUS_POLL_INTERVAL;
+			current = NULL;
+		}
+	}
+
+	I2CBus_StartNext();
+}
+
+//Documented in .h
+HAL_StatusTypeDef I2CBus_Wait(I2CBus_Job *job)
+{
+	uint32_t startTime = STM_GetMicros();
+	while(job->busy)
+	{
+		I2CBus_Process();
+	}
+	statistics[job->caller].blockingTime += STM_GetMicros() - startTime;
+	return job->status;
+}
+
+/**
+  * @brief Submits a job and waits until it has finished
+  * @param caller The caller the job is accounted to
+  * @param operation Kind of the transfer
+  * @param devAddress 7 bit address of the device
+  * @param address Memory address or control byte
+  * @param data Bytes to be sent or buffer for the bytes read
+  * @param size Number of bytes
+  * @return Status of the job
+  */
+static HAL_StatusTypeDef I2CBus_Execute(I2CBus_Caller_t caller, I2CBus_Operation_t operation, uint8_t devAddress, uint16_t address, uint8_t *data, uint16_t size)
+{
+	I2CBus_Job job =
+	{
+		.caller = caller,
+		.operation = operation,
+		.devAddress = devAddress,
+		.address = address,
+		.data = data,
+		.size = size
+	};
+	I2CBus_Submit(&job);
+	return I2CBus_Wait(&job);
+}
+
+//Documented in .h
+HAL_StatusTypeDef I2CBus_MemRead(I2CBus_Caller_t caller, uint8_t devAddress, uint16_t memAddress, uint8_t *data, uint16_t size)
+{
+	return I2CBus_Execute(caller, I2CBUS_MEM_READ, devAddress, memAddress, data, size);
+}
+
+//Documented in .h
+HAL_StatusTypeDef I2CBus_MemWrite(I2CBus_Caller_t caller, uint8_t devAddress, uint16_t memAddress, uint8_t *data, uint16_t size)
+{
+	return I2CBus_Execute(caller, I2CBUS_MEM_WRITE, devAddress, memAddress, data, size);
+}
+
+//Documented in .h
+HAL_StatusTypeDef I2CBus_Transmit(I2CBus_Caller_t caller, uint8_t devAddress, uint8_t control, uint8_t *data, uint16_t size)
+{
+	return I2CBus_Execute(caller, I2CBUS_TRANSMIT, devAddress, control, data, size);
+}
+
+//Documented in .h
+const I2CBus_Statistics* I2CBus_GetStatistics(I2CBus_Caller_t caller)
+{
+	return &statistics[caller];
+}
+
+//Documented in .h
+void I2CBus_ResetStatistics(void)
+{
+	for(uint8_t i = 0; i < I2CBus_Caller_t_MAX; i++)
+	{
+		statistics[i].transactions = 0;
+		statistics[i].bytes = 0;
+		statistics[i].blockingTime = 0;
+	}
+}
@@ -0,0 +1,155 @@
+/**
+ * @file I2CBus.h
+ * @brief Provides access to the I2C bus shared by the EEPROM and the display
+ * @details Every transfer on hi2c1 is a job in a single queue, which is executed with DMA and interrupts. The job of the
+ * caller with the highest priority is started next: reads of the EEPROM (instruction fetches) go before the display,
+ * writes to the EEPROM go last. Jobs of the same priority keep their order. A queued job that continues the job being
+ * started (same device and kind, following address and following bytes in RAM) is sent in the same transfer.
+ *
+ * After a write to the EEPROM the device does not acknowledge until its write cycle has finished. Jobs for it stay
+ * queued while jobs for other devices go ahead, and the EEPROM is polled at intervals by I2CBus_Process() instead of
+ * in a loop occupying the bus.
+ *
+ * The transactions, the bytes and the time spent waiting for jobs are counted for each caller. This shows where the
+ * time of a program is spent.
+ */
+
+#ifndef SRC_I2CBUS_H_
+#define SRC_I2CBUS_H_
+#include <stdbool.h>
+#include <stdint.h>
+#include "main.h"
+
+/**
+ * @brief Users of the I2C bus
+ * @details EEPROM reads have the highest priority, followed by the display and then EEPROM writes (see the file
+ * description).
+ */
+typedef enum {
+	I2CBUS_EEPROM_READ = 0,
+	I2CBUS_EEPROM_WRITE,
+	I2CBUS_DISPLAY_COMMAND,
+	I2CBUS_DISPLAY_DATA,
+	I2CBus_Caller_t_MAX
+} I2CBus_Caller_t;
+
+/**
+ * @brief Kinds of transfers
+ */
+typedef enum {
+	I2CBUS_MEM_READ = 0,	///< Reads bytes from a device with 16 bit memory addresses (EEPROM)
+	I2CBUS_MEM_WRITE,		///< Writes bytes to a device with 16 bit memory addresses (EEPROM), which is busy afterwards
+	I2CBUS_TRANSMIT			///< Sends a control byte followed by bytes (display)
+} I2CBus_Operation_t;
+
+typedef struct I2CBus_Job I2CBus_Job;
+
+/**
+ * @brief Function called when a job has finished (usually from the interrupt)
+ * @details May submit jobs, including the finished one.
+ */
+typedef void (*I2CBus_Callback)(I2CBus_Job *job);
+
+/**
+ * @brief A transfer on the I2C bus
+ * @details The job and its bytes belong to the bus from I2CBus_Submit() until busy is false.
+ */
+struct I2CBus_Job {
+	I2CBus_Caller_t caller;			///< Determines the priority, the transfer is accounted to it
+	I2CBus_Operation_t operation;	///< Kind of the transfer
+	uint8_t devAddress;				///< 7 bit address of the device
+	uint16_t address;				///< Memory address (I2CBUS_MEM_*) or control byte (I2CBUS_TRANSMIT)
+	uint8_t *data;					///< Bytes to be sent or buffer for the bytes read
+	uint16_t size;					///< Number of bytes
+	I2CBus_Callback done;			///< Called when the job has finished (NULL = none)
+	volatile bool busy;				///< The job is queued or being transferred
+	volatile HAL_StatusTypeDef status;	///< Result of the transfer (valid once busy is false)
+	I2CBus_Job *next;				///< Next job in the queue or in the same transfer (used by I2CBus.c)
+};
+
+/**
+ * @brief Struct to store the usage of the I2C bus by one caller
+ */
+typedef struct {
+	uint32_t transactions;	///< Number of transfers
+	uint32_t bytes;			///< Number of bytes transferred (memory address and data, without the device address)
+	uint32_t blockingTime;	///< Time (in us) spent waiting for jobs, including the time the device was busy
+} I2CBus_Statistics;
+
+
+/**
+  * @brief Adds a job to the queue and starts it if the bus is free
+  * @details May be called from the callback of a job.
+  * @param job The job, which must not be busy
+  */
+void I2CBus_Submit(I2CBus_Job *job);
+
+
+/**
+  * @brief Waits until a job has finished
+  * @details Returns at once if the job is not busy. The waiting time is accounted to the caller of the job.
+  * @param job The job
+  * @return Status of the job
+  */
+HAL_StatusTypeDef I2CBus_Wait(I2CBus_Job *job);
+
+
+/**
+  * @brief Polls a busy device if its time has come and starts the next job
+  * @details Is called while waiting for a job. Must not be called from an interrupt.
+  */
+void I2CBus_Process(void);
+
+
+/**
+  * @brief Reads bytes from a device with 16 bit memory addresses (EEPROM) and waits for them
+  * @param caller The caller the transfer is accounted to
+  * @param devAddress 7 bit address of the device
+  * @param memAddress Address of the first byte
+  * @param data Buffer the bytes are written to
+  * @param size Number of bytes to be read
+  * @return Status returned by HAL
+  */
+HAL_StatusTypeDef I2CBus_MemRead(I2CBus_Caller_t caller, uint8_t devAddress, uint16_t memAddress, uint8_t *data, uint16_t size);
+
+
+/**
+  * @brief Writes bytes to a device with 16 bit memory addresses (EEPROM) and waits until they have been sent
+  * @details Does not wait for the write cycle of the device, the next job for it does.
+  * @param caller The caller the transfer is accounted to
+  * @param devAddress 7 bit address of the device
+  * @param memAddress Address of the first byte
+  * @param data Bytes to be written
+  * @param size Number of bytes to be written
+  * @return Status returned by HAL
+  */
+HAL_StatusTypeDef I2CBus_MemWrite(I2CBus_Caller_t caller, uint8_t devAddress, uint16_t memAddress, uint8_t *data, uint16_t size);
+
+
+/**
+  * @brief Sends a control byte followed by bytes to a device (display) and waits until they have been sent
+  * @param caller The caller the transfer is accounted to
+  * @param devAddress 7 bit address of the device
+  * @param control Control byte telling the device how to interpret the bytes
+  * @param data Bytes to be sent
+  * @param size Number of bytes to be sent
+  * @return Status returned by HAL
+  */
+HAL_StatusTypeDef I2CBus_Transmit(I2CBus_Caller_t caller, uint8_t devAddress, uint8_t control, uint8_t *data, uint16_t size);
+
+
+/**
+  * @brief Returns the usage of the I2C bus by a caller since the last reset
+  * @param caller The caller
+  */
+const I2CBus_Statistics* I2CBus_GetStatistics(I2CBus_Caller_t caller);
+
+
+/**
+  * @brief Sets the statistics of all callers to zero
+  * @details Is called everytime the device is switched into executing mode.
+  */
+void I2CBus_ResetStatistics(void);
+
+
+#endif /* SRC_I2CBUS_H_ */
@@ -1,6 +1,6 @@
 /**
  * @file Instruction.h
- * @brief Defines the struct "Instruction"
+ * @brief Defines the struct "Instruction" and its decoded form "DecodedInstruction"
  */
 
 #ifndef INSTRUCTION_H
@@ -8,8 +8,15 @@
 #include <stdint.h>
 /**
  * @brief Struct to store an instruction containing a function number and 3 bytes of data
+ * @details The fields are in the same order as the 4 bytes of an instruction in the EEPROM,
+ * so instructions can be read into an array of this struct without copying (see ProgramStore_GetInstructions()).
  */
 typedef struct {
+	/**
+	 * @brief Function number
+	 */
+    uint8_t functionNumber;
+
 	/**
 	 * @brief First byte of data
 	 */
@@ -24,10 +31,56 @@ typedef struct {
 	 * @brief Third byte of data
 	 */
     uint8_t data3;
+} Instruction;
 
-    /**
+_Static_assert(sizeof(Instruction) == 4, "Instruction must match the 4 bytes stored in the EEPROM");
+
+/**
+ * @brief Defines a type that specifies the data format of an instruction.
+*/
+typedef enum{
+REG_NUMBER = 0,
+INT_NUMBER = 1,
+OTHER_DATA = 2,
+ANY_DATA = 3
+}Instruction_DataType_t;
+
+/**
+ * @brief Struct to store an instruction after its data has been decoded
+ * @details Instructions are decoded once when they are loaded for execution (see InstructionHandlers_Decode()),
+ * so the handlers can use the values directly instead of parsing the characters on every execution.
+ */
+typedef struct {
+	/**
 	 * @brief Function number
 	 */
     uint8_t functionNumber;
-} Instruction;
+
+    /**
+	 * @brief Data format of the instruction's data (an Instruction_DataType_t)
+	 */
+    uint8_t dataType;
+
+    /**
+	 * @brief Register index (only valid for REG_NUMBER)
+	 */
+    uint8_t reg;
+
+    /**
+	 * @brief Fusion started by this instruction together with the next one (index in definedFusions[] + 1, 0 = none)
+	 */
+    uint8_t fusion;
+
+    union {
+        /**
+         * @brief Numeric value (valid for INT_NUMBER, for BEG it holds the position of the matching END)
+         */
+        uint16_t value;
+
+        /**
+         * @brief The three data characters as written by the user (valid for OTHER_DATA and functions accepting ANY_DATA, e.g. PCH)
+         */
+        char text[3];
+    };
+} DecodedInstruction;
 #endif
@@ -0,0 +1,263 @@
+/**
+ * @file InstructionCache.c
+ * @brief Implementation of the instruction cache used in executing mode
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include "Instruction.h"
+#include "InstructionCache.h"
+#include "InstructionHandlers.h"
+#include "ProgramFlash.h"
+#include "ProgramStore.h"
+
+/**
+ * @brief Tag of a cache line that does not hold any line of the program
+ */
+#define INSTRUCTIONCACHE_EMPTY 0xFFFF
+
+/**
+ * @brief Format of the copy in the flash (must be increased whenever DecodedInstruction or the decoding changes)
+ */
+#define INSTRUCTIONCACHE_IMAGE_FORMAT 2
+
+/**
+ * @brief Pre-decoded copy of a program stored in the flash region (see ProgramFlash.h)
+ */
+typedef struct {
+	uint16_t format;	///< INSTRUCTIONCACHE_IMAGE_FORMAT (erased while the copy is being written)
+	uint16_t checksum;	///< Checksum of the program (see ProgramStore_GetChecksum())
+	uint16_t length;	///< Number of instructions
+	uint8_t slot;		///< Slot of the program
+	uint8_t reserved;
+	uint32_t functions;	///< Address of definedFunctions[] in the firmware that wrote the copy
+	uint32_t fusions;	///< Address of definedFusions[] in the firmware that wrote the copy
+	DecodedInstruction instructions[];	///< The decoded and fused instructions
+} InstructionCache_Image;
+
+/**
+ * @brief Maximum number of instructions in the copy in the flash
+ */
+#define INSTRUCTIONCACHE_IMAGE_INSTRUCTIONS ((PROGRAMFLASH_SIZE - sizeof(InstructionCache_Image)) / sizeof(DecodedInstruction))
+
+/**
+ * @brief Decoded instructions of the cached lines
+ */
+static DecodedInstruction cacheLines[INSTRUCTIONCACHE_LINES][INSTRUCTIONCACHE_LINE_SIZE];
+
+/**
+ * @brief Number of the line (position / INSTRUCTIONCACHE_LINE_SIZE) stored in each cache line
+ */
+static uint16_t cacheTags[INSTRUCTIONCACHE_LINES];
+
+/**
+ * @brief Number of the line whose first block has been read in the background (INSTRUCTIONCACHE_EMPTY if there is none)
+ */
+static uint16_t prefetchLine = INSTRUCTIONCACHE_EMPTY;
+
+/**
+ * @brief Number of the line the last instruction was taken from
+ */
+static uint16_t currentLine = INSTRUCTIONCACHE_EMPTY;
+
+/**
+ * @brief Copy in the flash the instructions are taken from (NULL if they are read from the EEPROM)
+ */
+static const InstructionCache_Image *image = NULL;
+
+/**
+ * @brief Number of accesses served from RAM
+ */
+static uint32_t cacheHits = 0;
+
+/**
+ * @brief Number of accesses that needed an EEPROM read
+ */
+static uint32_t cacheMisses = 0;
+
+/**
+ * @brief Number of misses served from the prefetch buffer
+ */
+static uint32_t prefetchHits = 0;
+
+
+//Documented in .h
+void InstructionCache_Invalidate(void)
+{
+	for(uint8_t i = 0; i < INSTRUCTIONCACHE_LINES; i++)
+	{
+		cacheTags[i] = INSTRUCTIONCACHE_EMPTY;
+	}
+	//A read still running only fills the window of the program store, its line is not counted anymore
+	prefetchLine = INSTRUCTIONCACHE_EMPTY;
+	currentLine = INSTRUCTIONCACHE_EMPTY;
+	image = NULL;
+	cacheHits = 0;
+	cacheMisses = 0;
+	prefetchHits = 0;
+}
+
+/**
+  * @brief Starts reading the first block of a line in the background unless the line is already cached or the bus is busy
+  * @param number Number of the line (position / INSTRUCTIONCACHE_LINE_SIZE)
+  */
+static void InstructionCache_Prefetch(uint16_t number)
+{
+	if(number == prefetchLine || cacheTags[number % INSTRUCTIONCACHE_LINES] == number)
+		return;
+
+	if(ProgramStore_Prefetch(number * INSTRUCTIONCACHE_LINE_SIZE))
+		prefetchLine = number;
+}
+
+/**
+  * @brief Reads a line and decodes its instructions into a cache line
+  * @details A block read in the background is taken from the window of the program store (see ProgramStore_Prefetch()).
+  * @param number Number of the line (position / INSTRUCTIONCACHE_LINE_SIZE)
+  * @param line Cache line to be filled
+  */
+static void InstructionCache_Fill(uint16_t number, uint8_t line)
+{
+	Instruction in[INSTRUCTIONCACHE_LINE_SIZE];
+
+	if(number == prefetchLine)
+	{
+		prefetchLine = INSTRUCTIONCACHE_EMPTY;
+		prefetchHits++;
+	}
+	ProgramStore_GetInstructions(in, number * INSTRUCTIONCACHE_LINE_SIZE, INSTRUCTIONCACHE_LINE_SIZE);
+
+	for(uint8_t i = 0; i < INSTRUCTIONCACHE_LINE_SIZE; i++)
+	{
+		InstructionHandlers_Decode(&in[i], number * INSTRUCTIONCACHE_LINE_SIZE + i, &cacheLines[line][i]);
+	}
+	InstructionHandlers_Fuse(cacheLines[line], INSTRUCTIONCACHE_LINE_SIZE);
+	cacheTags[line] = number;
+}
+
+//Documented in .h
+const DecodedInstruction* InstructionCache_GetInstruction(uint16_t position)
+{
+	if(image != NULL && position < image->length)
+		return &image->instructions[position];
+
+	uint16_t number = position / INSTRUCTIONCACHE_LINE_SIZE;
+	uint8_t line = number % INSTRUCTIONCACHE_LINES;
+
+	if(cacheTags[line] == number)
+	{
+		cacheHits++;
+	}
+	else
+	{
+		cacheMisses++;
+		InstructionCache_Fill(number, line);
+	}
+
+	//Load the following line while this one is executed
+	if(number != currentLine)
+	{
+		currentLine = number;
+		InstructionCache_Prefetch(number + 1);
+	}
+
+	return &cacheLines[line][position % INSTRUCTIONCACHE_LINE_SIZE];
+}
+
+/**
+  * @brief Writes the decoded program of the selected slot into the flash region
+  * @details The header is written last, its format first of all, so a copy interrupted by a power failure is never used.
+  * @param length Number of instructions
+  * @return false if the flash reported an error
+  */
+static bool InstructionCache_WriteImage(uint16_t length)
+{
+	if(!ProgramFlash_Erase(PROGRAMFLASH_COPY))
+		return false;
+
+	//One more instruction is decoded, so the last one of each chunk is fused with the first one of the next chunk
+	DecodedInstruction chunk[INSTRUCTIONCACHE_LINE_SIZE + 1];
+	Instruction in[INSTRUCTIONCACHE_LINE_SIZE + 1];
+	for(uint16_t position = 0; position < length; position += INSTRUCTIONCACHE_LINE_SIZE)
+	{
+		uint8_t count = length - position < INSTRUCTIONCACHE_LINE_SIZE ? length - position : INSTRUCTIONCACHE_LINE_SIZE;
+		ProgramStore_GetInstructions(in, position, count + 1);
+		for(uint8_t i = 0; i <= count; i++)
+		{
+			InstructionHandlers_Decode(&in[i], position + i, &chunk[i]);
+		}
+		InstructionHandlers_Fuse(chunk, count + 1);
+		if(!ProgramFlash_Write(PROGRAMFLASH_COPY, offsetof(InstructionCache_Image, instructions) + position * sizeof(DecodedInstruction), chunk, count * sizeof(DecodedInstruction)))
+			return false;
+	}
+
+	InstructionCache_Image header = {INSTRUCTIONCACHE_IMAGE_FORMAT, ProgramStore_GetChecksum(), length, ProgramStore_GetSlot(), 0,
+			(uint32_t)(uintptr_t)definedFunctions, (uint32_t)(uintptr_t)definedFusions};
+	return ProgramFlash_Write(PROGRAMFLASH_COPY, offsetof(InstructionCache_Image, checksum), &header.checksum, offsetof(InstructionCache_Image, instructions) - offsetof(InstructionCache_Image, checksum))
+		&& ProgramFlash_Write(PROGRAMFLASH_COPY, offsetof(InstructionCache_Image, format), &header.format, sizeof(header.format));
+}
+
+/**
+  * @brief Determines if the copy in the flash belongs to the selected slot and this firmware
+  * @details The function numbers and fusions in the copy refer to the tables of the firmware that wrote it,
+  * so a copy written by another firmware is not used even if the program is the same.
+  * @param flash The copy
+  * @param length Number of instructions to be executed
+  */
+static bool InstructionCache_IsValid(const InstructionCache_Image *flash, uint16_t length)
+{
+	return flash->format == INSTRUCTIONCACHE_IMAGE_FORMAT && flash->slot == ProgramStore_GetSlot()
+			&& flash->checksum == ProgramStore_GetChecksum() && flash->length == length
+			&& flash->functions == (uint32_t)(uintptr_t)definedFunctions && flash->fusions == (uint32_t)(uintptr_t)definedFusions;
+}
+
+//Documented in .h
+bool InstructionCache_UseFlash(uint16_t length, bool write)
+{
+	const InstructionCache_Image *flash = ProgramFlash_GetRegion(PROGRAMFLASH_COPY);
+	bool valid = InstructionCache_IsValid(flash, length);
+
+	if(!valid && write && length <= INSTRUCTIONCACHE_IMAGE_INSTRUCTIONS)
+		valid = InstructionCache_WriteImage(length);
+
+	image = valid ? flash : NULL;
+	return valid;
+}
+
+//Documented in .h
+void InstructionCache_Redirect(uint16_t position)
+{
+	uint16_t number = position / INSTRUCTIONCACHE_LINE_SIZE;
+
+	//The prefetched line is still needed if the target is inside it or in the line before it
+	if(prefetchLine != number && prefetchLine != number + 1)
+	{
+		prefetchLine = INSTRUCTIONCACHE_EMPTY;
+		//Prefetch the line following the target on its next access
+		currentLine = INSTRUCTIONCACHE_EMPTY;
+	}
+}
+
+//Documented in .h
+uint8_t InstructionCache_GetFunctionNumber(uint16_t position)
+{
+	return InstructionCache_GetInstruction(position)->functionNumber;
+}
+
+//Documented in .h
+uint32_t InstructionCache_GetHits(void)
+{
+	return cacheHits;
+}
+
+//Documented in .h
+uint32_t InstructionCache_GetMisses(void)
+{
+	return cacheMisses;
+}
+
+//Documented in .h
+uint32_t InstructionCache_GetPrefetchHits(void)
+{
+	return prefetchHits;
+}
@@ -0,0 +1,101 @@
+/**
+ * @file InstructionCache.h
+ * @brief Provides a RAM cache for instructions read from the EEPROM during execution
+ * @details The cache is direct-mapped and holds lines of INSTRUCTIONCACHE_LINE_SIZE consecutive positions. A miss fills
+ * the complete line with one sequential read per block it is stored in (see ProgramStore.h), so loops that fit into the
+ * cache are executed without any further I2C traffic.
+ * The instructions are decoded (see InstructionHandlers_Decode()) when their page is filled, so the handlers
+ * don't have to parse the data characters on every execution.
+ * While the instructions of a line are executed, the block holding the following line is read into the window of
+ * the program store with DMA (see ProgramStore_Prefetch()), so straight-line code finds its next line already loaded. Jumps to another line discard the prefetched line
+ * (see InstructionCache_Redirect()).
+ * The cache must be invalidated everytime the EEPROM contents might have changed (e.g. when entering executing mode).
+ *
+ * A program that fits into the flash region (see ProgramFlash.h) can instead be executed from a decoded copy in the
+ * flash (see InstructionCache_UseFlash()), which needs no I2C traffic at all. The copy is only rewritten when the
+ * checksum of the program or the firmware changes.
+ */
+
+#ifndef INSTRUCTIONCACHE_H
+#define INSTRUCTIONCACHE_H
+#include <stdbool.h>
+#include <stdint.h>
+#include "Instruction.h"
+
+/**
+ * @brief Number of cache lines
+ */
+#define INSTRUCTIONCACHE_LINES 4
+
+/**
+ * @brief Number of consecutive instructions held by a cache line
+ */
+#define INSTRUCTIONCACHE_LINE_SIZE 8
+
+
+/**
+  * @brief Marks all cache lines as empty and resets the hit and miss counters
+  * @details The copy in the flash is not used anymore until InstructionCache_UseFlash() is called again.
+  */
+void InstructionCache_Invalidate(void);
+
+
+/**
+  * @brief Takes the instructions from the decoded copy of the program in the flash instead of the EEPROM
+  * @details The copy is identified by the slot, the checksum and the length of the program and by the addresses of the
+  * function tables of the firmware. If it belongs to another program or firmware, it is only rewritten if requested
+  * and the program fits into the flash region.
+  * Must be called after InstructionHandlers_PrepareProgram(), which determines the END of every BEG stored in the copy.
+  * @param length Number of instructions to be executed
+  * @param write true to rewrite a copy that belongs to another program
+  * @return true if the instructions are taken from the flash
+  */
+bool InstructionCache_UseFlash(uint16_t length, bool write);
+
+
+/**
+  * @brief Returns the decoded instruction at the given position, reading its line from the EEPROM if necessary
+  * @details Instructions taken from the flash are neither counted as hits nor as misses.
+  * @param position Position of the instruction (0 equals the first instruction)
+  * @return Pointer to the decoded instruction inside the cache or the flash
+  * @warning The pointer is only valid until another line mapped to the same cache line is read
+  */
+const DecodedInstruction* InstructionCache_GetInstruction(uint16_t position);
+
+
+/**
+  * @brief Tells the cache that the execution continues at a non-sequential position (jump or context switch)
+  * @details A line being prefetched is discarded unless it contains the target or follows the target's line.
+  * @param position Position of the next instruction to be executed
+  */
+void InstructionCache_Redirect(uint16_t position);
+
+
+/**
+  * @brief Returns the function number of the instruction at the given position, reading its line from the EEPROM if necessary
+  * @param position Position of the instruction (0 equals the first instruction)
+  * @return Function number of the instruction
+  */
+uint8_t InstructionCache_GetFunctionNumber(uint16_t position);
+
+
+/**
+  * @brief Returns the number of accesses served from RAM since the last invalidation
+  */
+uint32_t InstructionCache_GetHits(void);
+
+
+/**
+  * @brief Returns the number of accesses which needed a line to be read from the EEPROM since the last invalidation
+  */
+uint32_t InstructionCache_GetMisses(void);
+
+
+/**
+  * @brief Returns the number of misses served from a prefetched line since the last invalidation
+  * @details These misses only waited for the rest of the background read (if any) instead of a whole read.
+  */
+uint32_t InstructionCache_GetPrefetchHits(void);
+
+
+#endif
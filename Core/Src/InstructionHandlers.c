@@ -8,17 +8,78 @@
 #include <stdint.h>
 #include "Display.h"
 #include "EEPROM.h"
+#include "InstructionCache.h"
 #include "InstructionList.h"
+#include "Scheduler.h"
 #include "STM_FUNCTIONS.h"
 
-/**
- * @brief Defines a type that specifies the data format of an instruction.
-*/
-typedef enum{
-REG_NUMBER = 0,
-INT_NUMBER = 1,
-OTHER_DATA = 2
-}Instruction_DataType_t;
+//Documented in .h
+const FunctionDefinition definedFunctions[Function_t_MAX] = {
+  [FUNCTION_EMP] = {{ ' ', ' ', ' ' }, op_EMP, ANY_DATA, 0},
+  [FUNCTION_PIC] = {{ 'P', 'I', 'C' }, op_PIC, REG_NUMBER, 100},
+  [FUNCTION_SET] = {{ 'S', 'E', 'T' }, op_SET, INT_NUMBER, 0},
+  [FUNCTION_INC] = {{ 'I', 'N', 'C' }, op_INC_DEC, INT_NUMBER, 0},
+  [FUNCTION_DEC] = {{ 'D', 'E', 'C' }, op_INC_DEC, INT_NUMBER, 0},
+  [FUNCTION_COP] = {{ 'C', 'O', 'P' }, op_COP, REG_NUMBER, 100},
+  [FUNCTION_ADD] = {{ 'A', 'D', 'D' }, op_ADD_SUB, REG_NUMBER, 100},
+  [FUNCTION_SUB] = {{ 'S', 'U', 'B' }, op_ADD_SUB, REG_NUMBER, 100},
+  [FUNCTION_SMA] = {{ 'S', 'M', 'A' }, op_SMA_BIG, REG_NUMBER, 100},
+  [FUNCTION_BIG] = {{ 'B', 'I', 'G' }, op_SMA_BIG, REG_NUMBER, 100},
+  [FUNCTION_REQ] = {{ 'R', 'E', 'Q' }, op_REQ_RNQ, REG_NUMBER, 100},
+  [FUNCTION_RNQ] = {{ 'R', 'N', 'Q' }, op_REQ_RNQ, REG_NUMBER, 100},
+  [FUNCTION_VEQ] = {{ 'V', 'E', 'Q' }, op_VEQ_VNQ, INT_NUMBER, 0},
+  [FUNCTION_VNQ] = {{ 'V', 'N', 'Q' }, op_VEQ_VNQ, INT_NUMBER, 0},
+  [FUNCTION_ANH] = {{ 'A', 'N', 'H' }, op_ANH_ANL, REG_NUMBER, 9},
+  [FUNCTION_ANL] = {{ 'A', 'N', 'L' }, op_ANH_ANL, REG_NUMBER, 9},
+  [FUNCTION_SVA] = {{ 'S', 'V', 'A' }, op_SVA, INT_NUMBER, 9},
+  [FUNCTION_INH] = {{ 'I', 'N', 'H' }, op_INH_INL, INT_NUMBER, 4},
+  [FUNCTION_INL] = {{ 'I', 'N', 'L' }, op_INH_INL, INT_NUMBER, 4},
+  [FUNCTION_TON] = {{ 'T', 'O', 'N' }, op_TON, OTHER_DATA, 0},
+  [FUNCTION_PTR] = {{ 'P', 'T', 'R' }, op_PTR, REG_NUMBER, 100},
+  [FUNCTION_PCH] = {{ 'P', 'C', 'H' }, op_PCH, ANY_DATA, 0},
+  [FUNCTION_CLR] = {{ 'C', 'L', 'R' }, op_CLR, ANY_DATA, 0},
+  [FUNCTION_BEG] = {{ 'B', 'E', 'G' }, op_BEG_END, ANY_DATA, 0},
+  [FUNCTION_END] = {{ 'E', 'N', 'D' }, op_BEG_END, ANY_DATA, 0},
+  [FUNCTION_WAI] = {{ 'W', 'A', 'I' }, op_WAI, INT_NUMBER, 0},
+  [FUNCTION_SPO] = {{ 'S', 'P', 'O' }, op_SPO, REG_NUMBER, 100},
+  [FUNCTION_JPO] = {{ 'J', 'P', 'O' }, op_JPO, REG_NUMBER, 100},
+  [FUNCTION_JUM] = {{ 'J', 'U', 'M' }, op_JUM, INT_NUMBER, 0},
+  [FUNCTION_LD1] = {{ 'L', 'D', '1' }, op_LD1_LD2, OTHER_DATA, 0},
+  [FUNCTION_LD2] = {{ 'L', 'D', '2' }, op_LD1_LD2, OTHER_DATA, 0},
+  [FUNCTION_THR] = {{ 'T', 'H', 'R' }, op_THR, INT_NUMBER, 0},
+  [FUNCTION_YLD] = {{ 'Y', 'L', 'D' }, op_YLD, ANY_DATA, 0},
+  [FUNCTION_PRS] = {{ 'P', 'R', 'S' }, op_PRS, INT_NUMBER, 4},
+  [FUNCTION_WFP] = {{ 'W', 'F', 'P' }, op_WFP, INT_NUMBER, 4},
+  [FUNCTION_CHN] = {{ 'C', 'H', 'N' }, op_CHN, INT_NUMBER, PROGRAMSTORE_SLOTS}
+  //Add your own here
+};
+
+//Documented in .h
+const FusionDefinition definedFusions[] = {
+  { FUNCTION_PIC, FUNCTION_SET, fused_PIC_SET },
+  { FUNCTION_PIC, FUNCTION_INC, fused_PIC },
+  { FUNCTION_PIC, FUNCTION_DEC, fused_PIC },
+  { FUNCTION_PIC, FUNCTION_ADD, fused_PIC },
+  { FUNCTION_PIC, FUNCTION_SUB, fused_PIC },
+  { FUNCTION_PIC, FUNCTION_COP, fused_PIC },
+  { FUNCTION_PIC, FUNCTION_PTR, fused_PIC },
+  { FUNCTION_PIC, FUNCTION_VEQ, fused_PIC },
+  { FUNCTION_PIC, FUNCTION_VNQ, fused_PIC },
+  { FUNCTION_SMA, FUNCTION_BEG, fused_Condition_BEG },
+  { FUNCTION_BIG, FUNCTION_BEG, fused_Condition_BEG },
+  { FUNCTION_REQ, FUNCTION_BEG, fused_Condition_BEG },
+  { FUNCTION_RNQ, FUNCTION_BEG, fused_Condition_BEG },
+  { FUNCTION_VEQ, FUNCTION_BEG, fused_Condition_BEG },
+  { FUNCTION_VNQ, FUNCTION_BEG, fused_Condition_BEG },
+  { FUNCTION_ANH, FUNCTION_BEG, fused_Condition_BEG },
+  { FUNCTION_ANL, FUNCTION_BEG, fused_Condition_BEG },
+  { FUNCTION_INH, FUNCTION_BEG, fused_Condition_BEG },
+  { FUNCTION_INL, FUNCTION_BEG, fused_Condition_BEG },
+  { FUNCTION_PRS, FUNCTION_BEG, fused_Condition_BEG },
+  { FUNCTION_SPO, FUNCTION_JUM, fused_SPO_JUM },
+  { FUNCTION_SPO, FUNCTION_JPO, fused_SPO_JPO }
+  //Add your own here
+};
 
 /**
  * @brief Points at the chosen register (used by PIC and other register commands)
@@ -31,52 +92,331 @@ static uint8_t regPointer = 0;
  */
 static uint16_t registers[100];
 
-/**
-* @brief The data type determined by InstructionHandlers_ProcessData()
-*/
-static Instruction_DataType_t currentDataType;
-
-/**
-* @brief The data value processed by InstructionHandlers_ProcessData()
-*/
-static uint8_t currentData;
-
 /**
  * @brief Position of the cursor for PCH and PTR commands
  */
 static uint8_t cursPos = 0;
 
+/**
+ * @brief Slot requested by the last CHN instruction (PROGRAMSTORE_SLOTS if none)
+ */
+static uint8_t chainSlot = PROGRAMSTORE_SLOTS;
+
 /**
 * @brief The current program index provided by InstructionList.h
 */
 extern uint16_t programIndex;
 
+/**
+ * @brief Maximum number of BEG/END blocks whose END is kept in blocks[] (see GetBlockEnd())
+ */
+#define MAX_BLOCKS 64
+
+/**
+ * @brief Maximum nesting depth of BEG/END blocks whose END is kept in blocks[] (see GetBlockEnd())
+ */
+#define MAX_BLOCK_DEPTH 16
+
+/**
+ * @brief Struct to store the positions of a BEG instruction and its matching END instruction
+ */
+typedef struct {
+	/**
+	 * @brief Position of the BEG instruction
+	 */
+	uint16_t beg;
+
+	/**
+	 * @brief Position of the matching END instruction
+	 */
+	uint16_t end;
+} Block;
+
+/**
+ * @brief All BEG/END blocks of the program, sorted by the position of BEG (filled by InstructionHandlers_PrepareProgram())
+ */
+static Block blocks[MAX_BLOCKS];
+
+/**
+ * @brief Number of entries in blocks[]
+ */
+static uint8_t blockCount = 0;
+
+/**
+ * @brief Marks that the program has been checked without faults and blocks[] belongs to it
+ */
+static bool prepared = false;
+
+/**
+ * @brief Slot of the program that has been checked
+ */
+static uint8_t preparedSlot = 0;
+
+/**
+ * @brief Checksum of the program that has been checked (see ProgramStore_GetChecksum())
+ */
+static uint16_t preparedChecksum = 0;
+
+/**
+ * @brief Length of the program that has been checked
+ */
+static uint16_t preparedLength = 0;
+
+/**
+  * @brief Returns the entry of a BEG instruction in blocks[]
+  * @param beg Position of the BEG instruction
+  * @return Index of the entry (blockCount if the BEG has none)
+  */
+static uint8_t FindBlock(uint16_t beg)
+{
+	uint8_t low = 0;
+	uint8_t high = blockCount;
+	while(high - low > 1)
+	{
+		uint8_t mid = (low + high) / 2;
+		if(blocks[mid].beg > beg)
+			high = mid;
+		else
+			low = mid;
+	}
+	if(blockCount == 0 || blocks[low].beg != beg)
+		return blockCount;
+	return low;
+}
+
+/**
+  * @brief Searches the program for the END instruction matching a BEG instruction
+  * @details Is only used for the blocks that don't fit into blocks[] (see MAX_BLOCKS and MAX_BLOCK_DEPTH).
+  * @param beg Position of the BEG instruction
+  * @return Position of the matching END instruction (or beg itself, if there is none)
+  */
+static uint16_t ScanBlockEnd(uint16_t beg)
+{
+	Instruction in[8];
+	uint16_t depth = 1;
+	for(uint16_t position = beg + 1; position < preparedLength; position += sizeof(in) / sizeof(Instruction))
+	{
+		ProgramStore_GetInstructions(in, position, sizeof(in) / sizeof(Instruction));
+		for(uint8_t i = 0; i < sizeof(in) / sizeof(Instruction) && position + i < preparedLength; i++)
+		{
+			if(in[i].functionNumber == FUNCTION_BEG)
+				depth++;
+			else if(in[i].functionNumber == FUNCTION_END && --depth == 0)
+				return position + i;
+		}
+	}
+	return beg;
+}
+
+/**
+  * @brief Returns the position of the END instruction matching a BEG instruction
+  * @param beg Position of the BEG instruction
+  * @return Position of the matching END instruction (or beg itself, if the BEG lies behind the end of the program)
+  * @warning InstructionHandlers_PrepareProgram() must have been called successfully before
+  */
+static uint16_t GetBlockEnd(uint16_t beg)
+{
+	uint8_t block = FindBlock(beg);
+	if(block < blockCount)
+		return blocks[block].end;
+
+	//Only the checked program is searched, not one that is being checked or edited
+	if(prepared && ProgramStore_GetChecksum() == preparedChecksum)
+		return ScanBlockEnd(beg);
+	return beg;
+}
+
+/**
+  * @brief Determines if a character is a decimal digit
+  * @param ch The character to be checked
+  * @return true if the character is one of '0'-'9'
+  */
+static bool IsDigit(uint8_t ch)
+{
+	return ch >= '0' && ch <= '9';
+}
+
+/**
+  * @brief Determines if a decoded instruction exists and its data has the format and range expected by its function
+  * @param exe The decoded instruction
+  * @return true if the instruction can be executed
+  */
+static bool IsValid(const DecodedInstruction *exe)
+{
+	if(exe->functionNumber >= Function_t_MAX)
+		return false;
+
+	const FunctionDefinition *function = &definedFunctions[exe->functionNumber];
+	if(function->operand == ANY_DATA)
+		return true;
+	if(function->operand != exe->dataType)
+		return false;
+
+	if(function->limit == 0)
+		return true;
+	if(exe->dataType == REG_NUMBER)
+		return exe->reg < function->limit;
+	if(exe->dataType == INT_NUMBER)
+		return exe->value < function->limit;
+	return true;
+}
+
 //Documented in .h
-void InstructionHandlers_ProcessData(Instruction *exe)
+bool InstructionHandlers_Decode(const Instruction *in, uint16_t position, DecodedInstruction *out)
 {
-    if(exe->data == 'R')
-    {
-        currentDataType = REG_NUMBER;
-        if (exe->data3 >= 58 || exe->data3 <= 48)
-        currentData = (exe->data2 - 48);
-        else if (exe->data2 >= 58 || exe->data2 <= 48)
-        currentData=((exe->data2 - 48) * 10 + exe->data3 - 48);
-        else currentData = 0; //Throw Exception
-    }
-    else if (exe->data >= 48 && exe->data <= 58) {
-        currentDataType = INT_NUMBER;
-        if (exe->data3 >= 48 && exe->data3 <= 58) {
-            currentData = ((exe->data - 48) * 100 + (exe->data2 - 48) * 10
-                    + exe->data3 - 48);
-        } else if (exe->data2 >= 48 && exe->data2 <= 58) {
-            currentData = ((exe->data - 48) * 10 + exe->data2 - 48);
-        } else{
-            currentData = (exe->data - 48);
-        }
-    }
-    else {
-        currentDataType = OTHER_DATA;
-    }
+	out->functionNumber = in->functionNumber;
+	out->reg = 0;
+	out->fusion = 0;
+	out->value = 0;
+
+	if(in->data == 'R' && IsDigit(in->data2))
+	{
+		out->dataType = REG_NUMBER;
+		out->reg = in->data2 - '0';
+		if(IsDigit(in->data3))
+			out->reg = out->reg * 10 + in->data3 - '0';
+	}
+	else if(IsDigit(in->data))
+	{
+		out->dataType = INT_NUMBER;
+		out->value = in->data - '0';
+		if(IsDigit(in->data2))
+		{
+			out->value = out->value * 10 + in->data2 - '0';
+			if(IsDigit(in->data3))
+				out->value = out->value * 10 + in->data3 - '0';
+		}
+	}
+	else
+	{
+		out->dataType = OTHER_DATA;
+	}
+
+	if(!IsValid(out))
+		return false;
+
+	if(out->functionNumber == FUNCTION_BEG)
+	{
+		out->value = GetBlockEnd(position);
+	}
+	else if(out->dataType == OTHER_DATA || definedFunctions[out->functionNumber].operand == ANY_DATA)
+	{
+		out->text[0] = in->data;
+		out->text[1] = in->data2;
+		out->text[2] = in->data3;
+	}
+	return true;
+}
+
+//Documented in .h
+void InstructionHandlers_Fuse(DecodedInstruction line[], uint8_t count)
+{
+	for(uint8_t i = 0; i + 1 < count; i++)
+	{
+		line[i].fusion = 0;
+		for(uint8_t j = 0; j < sizeof(definedFusions) / sizeof(FusionDefinition); j++)
+		{
+			if(line[i].functionNumber == definedFusions[j].first && line[i+1].functionNumber == definedFusions[j].second)
+			{
+				line[i].fusion = j + 1;
+				break;
+			}
+		}
+	}
+}
+
+/**
+  * @brief Adds a position to the sorted list of faulty lines (positions beyond MAX_FAULTY_LINES are dropped)
+  * @param faultyLines The list of faulty lines
+  * @param count Number of entries in the list
+  * @param position Position of the faulty instruction
+  */
+static void AddFaultyLine(uint16_t faultyLines[MAX_FAULTY_LINES], uint8_t *count, uint16_t position)
+{
+	uint8_t i = *count;
+	if(i == MAX_FAULTY_LINES)
+	{
+		if(faultyLines[i-1] < position)
+			return;
+		i--;
+	}
+	else
+	{
+		(*count)++;
+	}
+
+	for(; i > 0 && faultyLines[i-1] > position; i--)
+	{
+		faultyLines[i] = faultyLines[i-1];
+	}
+	faultyLines[i] = position;
+}
+
+//Documented in .h
+uint8_t InstructionHandlers_PrepareProgram(uint16_t *programLength, uint16_t faultyLines[MAX_FAULTY_LINES])
+{
+	uint16_t openBlocks[MAX_BLOCK_DEPTH];
+	uint16_t depth = 0;
+	uint8_t faultyCount = 0;
+
+	//The length is needed to check the jump targets
+	*programLength = ProgramStore_GetLength();
+
+	//The blocks of an unchanged program are still known from the last check
+	if(prepared && ProgramStore_GetSlot() == preparedSlot && ProgramStore_GetChecksum() == preparedChecksum && *programLength == preparedLength)
+		return 0;
+	prepared = false;
+	blockCount = 0;
+
+	for(uint16_t i = 0; i < *programLength; i++)
+	{
+		const DecodedInstruction *exe = InstructionCache_GetInstruction(i);
+
+		if(!IsValid(exe))
+		{
+			AddFaultyLine(faultyLines, &faultyCount, i);
+		}
+		else if(exe->functionNumber == FUNCTION_JUM || exe->functionNumber == FUNCTION_THR)
+		{
+			if(exe->value > *programLength)
+				AddFaultyLine(faultyLines, &faultyCount, i);
+		}
+		else if(exe->functionNumber == FUNCTION_BEG)
+		{
+			//Blocks beyond the limits of blocks[] are searched for their END when they are decoded
+			if(depth < MAX_BLOCK_DEPTH)
+			{
+				openBlocks[depth] = i;
+				if(blockCount < MAX_BLOCKS)
+					blocks[blockCount++].beg = i;
+			}
+			depth++;
+		}
+		else if(exe->functionNumber == FUNCTION_END)
+		{
+			if(depth == 0)
+				AddFaultyLine(faultyLines, &faultyCount, i);
+			else if(--depth < MAX_BLOCK_DEPTH)
+			{
+				uint8_t block = FindBlock(openBlocks[depth]);
+				if(block < blockCount)
+					blocks[block].end = i;
+			}
+		}
+	}
+
+	//Blocks nested deeper than MAX_BLOCK_DEPTH are not reported, their outer blocks are open as well
+	while(depth > 0)
+	{
+		if(--depth < MAX_BLOCK_DEPTH)
+			AddFaultyLine(faultyLines, &faultyCount, openBlocks[depth]);
+	}
+
+	prepared = faultyCount == 0;
+	preparedSlot = ProgramStore_GetSlot();
+	preparedChecksum = ProgramStore_GetChecksum();
+	preparedLength = *programLength;
+	return faultyCount;
 }
 
 /**
@@ -94,16 +434,11 @@ static void EvaluateCondition(bool condition) {
 
 	if(!condition)
 	{
-		uint8_t openedBrackets = 1;
-		if (EEPROM_GetFunctionNumber(programIndex) == FUNCTION_BEG) {
-			while (EEPROM_GetFunctionNumber(programIndex) != FUNCTION_END
-					|| openedBrackets > 0) {
-				programIndex++;
-				if (EEPROM_GetFunctionNumber(programIndex) == FUNCTION_BEG)
-					openedBrackets++;
-				if (EEPROM_GetFunctionNumber(programIndex) == FUNCTION_END)
-					openedBrackets--;
-			}
+		const DecodedInstruction *next = InstructionCache_GetInstruction(programIndex);
+		if (next->functionNumber == FUNCTION_BEG)
+		{
+			programIndex = next->value;
+			InstructionCache_Redirect(programIndex + 1);
 		}
 		programIndex++;
 	}
@@ -119,10 +454,58 @@ void InstructionHandlers_INIT()
     programIndex = 0;
     regPointer = 0;
     cursPos = 0;
+    chainSlot = PROGRAMSTORE_SLOTS;
 
     lastWaitTick = HAL_GetTick();
 }
 
+//Documented in .h
+void InstructionHandlers_SaveContext(ProgramContext *context)
+{
+    context->programIndex = programIndex;
+    context->regPointer = regPointer;
+    context->cursPos = cursPos;
+    context->lastWaitTick = lastWaitTick;
+}
+
+//Documented in .h
+void InstructionHandlers_LoadContext(const ProgramContext *context)
+{
+    programIndex = context->programIndex;
+    InstructionCache_Redirect(programIndex);
+    regPointer = context->regPointer;
+    cursPos = context->cursPos;
+    lastWaitTick = context->lastWaitTick;
+}
+
+//Documented in .h
+bool InstructionHandlers_TakeChain(uint8_t *slot)
+{
+    if(chainSlot >= PROGRAMSTORE_SLOTS)
+        return false;
+    *slot = chainSlot;
+    chainSlot = PROGRAMSTORE_SLOTS;
+    return true;
+}
+
+//Documented in .h
+uint16_t* InstructionHandlers_GetRegisters(void)
+{
+    return registers;
+}
+
+//Documented in .h
+uint8_t InstructionHandlers_GetRegPointer(void)
+{
+    return regPointer;
+}
+
+//Documented in .h
+void InstructionHandlers_SetRegPointer(uint8_t pointer)
+{
+    regPointer = pointer;
+}
+
 /**
   * @brief Writes up to 3 characters at the current position of the cursor variable (cursPos)
   * @param str Characters to be written (character that equal 0 will be ignored)
@@ -143,176 +526,245 @@ static void WriteAtCursor(char str[3])
 
 
 //Documented in .h
-void op_EMP_BEG_END(Instruction *exe)
+void op_EMP(const DecodedInstruction *exe)
+{
+    //Instructions following an empty one are only reached by jumps
+    programIndex = preparedLength;
+}
+
+//Documented in .h
+void op_BEG_END(const DecodedInstruction *exe)
 {
     
 }
 
 //Documented in .h
-void op_PIC(Instruction *exe)
+void op_PIC(const DecodedInstruction *exe)
 {
-    if(currentDataType != REG_NUMBER) Display_ShowErrorMessage(programIndex-1);
-    regPointer = currentData;
+    regPointer = exe->reg;
 }
 
 //Documented in .h
-void op_SET(Instruction *exe)
+void op_SET(const DecodedInstruction *exe)
 {
-    if(currentDataType != INT_NUMBER) Display_ShowErrorMessage(programIndex-1);
-    registers[regPointer] = currentData;
+    registers[regPointer] = exe->value;
 }
 
 //Documented in .h
-void op_INC_DEC(Instruction *exe)
+void op_INC_DEC(const DecodedInstruction *exe)
 {
-    if(currentDataType != INT_NUMBER) Display_ShowErrorMessage(programIndex-1);
     registers[regPointer] = 
     (exe->functionNumber == FUNCTION_INC) ? 
-    (registers[regPointer] + currentData) : 
-    (registers[regPointer] - currentData);
+    (registers[regPointer] + exe->value) : 
+    (registers[regPointer] - exe->value);
 }
 
 
 //Documented in .h
-void op_COP(Instruction *exe)
+void op_COP(const DecodedInstruction *exe)
 {
-    if(currentDataType != REG_NUMBER) Display_ShowErrorMessage(programIndex-1);
-    registers[currentData] = registers[regPointer];
+    registers[exe->reg] = registers[regPointer];
 }
 
 //Documented in .h
-void op_ADD_SUB(Instruction *exe)
+void op_ADD_SUB(const DecodedInstruction *exe)
 {
-    if(currentDataType != REG_NUMBER) Display_ShowErrorMessage(programIndex-1);
     registers[regPointer] += 
     (exe->functionNumber == FUNCTION_ADD) ? 
-    (registers[currentData]) :
-    (-registers[currentData]);
+    (registers[exe->reg]) :
+    (-registers[exe->reg]);
 }
 
 //Documented in .h
-void op_SMA_BIG(Instruction *exe)
+void op_SMA_BIG(const DecodedInstruction *exe)
 {
-    if(currentDataType != REG_NUMBER) Display_ShowErrorMessage(programIndex-1);
     EvaluateCondition(
         (exe->functionNumber == FUNCTION_SMA) ? 
-        (registers[regPointer] < registers[currentData]) :
-        (registers[regPointer] > registers[currentData])
+        (registers[regPointer] < registers[exe->reg]) :
+        (registers[regPointer] > registers[exe->reg])
     );
 }
 
 //Documented in .h
-void op_REQ_RNQ(Instruction *exe)
+void op_REQ_RNQ(const DecodedInstruction *exe)
 {
-    if(currentDataType != REG_NUMBER) Display_ShowErrorMessage(programIndex-1);
     EvaluateCondition(
         (exe->functionNumber == FUNCTION_REQ) ? 
-        (registers[regPointer] == registers[currentData]) :
-        (registers[regPointer] != registers[currentData])
+        (registers[regPointer] == registers[exe->reg]) :
+        (registers[regPointer] != registers[exe->reg])
     );
 }
 
 //Documented in .h
-void op_VEQ_VNQ(Instruction *exe)
+void op_VEQ_VNQ(const DecodedInstruction *exe)
 {
-    if(currentDataType != INT_NUMBER) Display_ShowErrorMessage(programIndex-1);
     EvaluateCondition(
         (exe->functionNumber == FUNCTION_VEQ) ? 
-        (currentData == registers[regPointer]) :
-        (currentData != registers[regPointer])
+        (exe->value == registers[regPointer]) :
+        (exe->value != registers[regPointer])
     );
 }
 
 //Documented in .h
-void op_ANH_ANL(Instruction *exe)
+void op_ANH_ANL(const DecodedInstruction *exe)
 {
-    if(currentDataType != REG_NUMBER) Display_ShowErrorMessage(programIndex-1);
     EvaluateCondition(
         (exe->functionNumber == FUNCTION_ANH) ? 
-        (registers[regPointer] < STM_ReadADC(currentData)):
-        (registers[regPointer] > STM_ReadADC(currentData))
+        (registers[regPointer] < STM_ReadADC(exe->reg)):
+        (registers[regPointer] > STM_ReadADC(exe->reg))
     );
 }
 
 ///Documented in .h
-void op_SVA(Instruction *exe)
+void op_SVA(const DecodedInstruction *exe)
 {
-    if(currentDataType != INT_NUMBER) Display_ShowErrorMessage(programIndex-1);
-    registers[regPointer] = STM_ReadADC(currentData);
+    registers[regPointer] = STM_ReadADC(exe->value);
 }
 
 //Documented in .h
-void op_INH_INL(Instruction *exe)
+void op_INH_INL(const DecodedInstruction *exe)
 {
-    if(currentDataType != INT_NUMBER) Display_ShowErrorMessage(programIndex-1);
     EvaluateCondition(
         (exe->functionNumber == FUNCTION_INH) ?
-        STM_IsInputHigh(currentData):
-        STM_IsInputHigh(currentData)
+        STM_IsInputHigh(exe->value):
+        !STM_IsInputHigh(exe->value)
     );
 }
 
 //Documented in .h
-void op_TON(Instruction *exe)
+void op_PRS(const DecodedInstruction *exe)
 {
-    if(currentDataType != OTHER_DATA) Display_ShowErrorMessage(programIndex-1);
-    STM_ActivateBuzzer(*exe); 
+    EvaluateCondition(STM_TakeButtonPress(exe->value));
+}
+
+//Documented in .h
+void op_WFP(const DecodedInstruction *exe)
+{
+    if(!STM_TakeButtonPress(exe->value))
+    {
+        //Check again after the next tick
+        programIndex--;
+        Scheduler_Suspend(HAL_GetTick() + 1);
+    }
 }
 
 //Documented in .h
-void op_PTR(Instruction *exe)
+void op_TON(const DecodedInstruction *exe)
+{
+    Instruction tone = {.functionNumber = exe->functionNumber, .data = exe->text[0], .data2 = exe->text[1], .data3 = exe->text[2]};
+    STM_ActivateBuzzer(tone); 
+}
+
+//Documented in .h
+void op_PTR(const DecodedInstruction *exe)
 {
-    if(currentDataType != REG_NUMBER) Display_ShowErrorMessage(programIndex-1);
     char str[3];
-    STM_Number3ToChar(registers[currentData], str);
+    STM_Number3ToChar(registers[exe->reg], str);
     WriteAtCursor(str);
 }
 
 //Documented in .h
-void op_PCH(Instruction *exe)
+void op_PCH(const DecodedInstruction *exe)
 {
-    char str[] = {exe->data, exe->data2, exe->data3};
+    char str[] = {exe->text[0], exe->text[1], exe->text[2]};
 	WriteAtCursor(str);
 }
 
 //Documented in .h
-void op_CLR(Instruction *exe)
+void op_CLR(const DecodedInstruction *exe)
 {
     cursPos = 0;
 	Display_FillBlack();
 }
 
 //Documented in .h
-void op_WAI(Instruction *exe)
+void op_WAI(const DecodedInstruction *exe)
+{
+    Scheduler_Suspend(STM_GetWaitEnd(exe->value));
+}
+
+//Documented in .h
+void op_SPO(const DecodedInstruction *exe)
+{
+    registers[exe->reg] = programIndex-1;
+}
+
+//Documented in .h
+void op_JPO(const DecodedInstruction *exe)
 {
-    if(currentDataType != INT_NUMBER) Display_ShowErrorMessage(programIndex-1);
-    STM_Wait(currentData);
+    programIndex = registers[exe->reg];
+    InstructionCache_Redirect(programIndex);
 }
 
 //Documented in .h
-void op_SPO(Instruction *exe)
+void op_JUM(const DecodedInstruction *exe)
 {
-    if(currentDataType != REG_NUMBER) Display_ShowErrorMessage(programIndex-1);
-    registers[currentData] = programIndex-1;
+    programIndex = exe->value;
+    InstructionCache_Redirect(programIndex);
 }
 
 //Documented in .h
-void op_JPO(Instruction *exe)
+void op_LD1_LD2(const DecodedInstruction *exe)
 {
-    if(currentDataType != REG_NUMBER) Display_ShowErrorMessage(programIndex-1);
-    programIndex = registers[currentData];
+    STM_SetLED(exe->functionNumber, exe->text[0]);
 }
 
 //Documented in .h
-void op_JUM(Instruction *exe)
+void op_THR(const DecodedInstruction *exe)
 {
-    if(currentDataType != INT_NUMBER) Display_ShowErrorMessage(programIndex-1);
-    programIndex = currentData;
+    Scheduler_Start(exe->value);
 }
 
 //Documented in .h
-void op_LD1_LD2(Instruction *exe)
+void op_YLD(const DecodedInstruction *exe)
 {
-    if(currentDataType != OTHER_DATA) Display_ShowErrorMessage(programIndex-1);
-    STM_SetLED(exe->functionNumber, exe->data);
-}
\ No newline at end of file
+    Scheduler_Yield();
+}
+
+//Documented in .h
+void op_CHN(const DecodedInstruction *exe)
+{
+    chainSlot = exe->value;
+    Scheduler_Exit();
+}
+
+//Documented in .h
+void fused_PIC_SET(const DecodedInstruction *exe)
+{
+    regPointer = exe->reg;
+    registers[regPointer] = exe[1].value;
+    programIndex++;
+}
+
+//Documented in .h
+void fused_PIC(const DecodedInstruction *exe)
+{
+    regPointer = exe->reg;
+    programIndex++;
+    definedFunctions[exe[1].functionNumber].handler(&exe[1]);
+}
+
+//Documented in .h
+void fused_Condition_BEG(const DecodedInstruction *exe)
+{
+    uint16_t begPosition = programIndex;
+    definedFunctions[exe->functionNumber].handler(exe);
+    if(programIndex == begPosition)
+        programIndex++;
+}
+
+//Documented in .h
+void fused_SPO_JUM(const DecodedInstruction *exe)
+{
+    registers[exe->reg] = programIndex-1;
+    programIndex = exe[1].value;
+    InstructionCache_Redirect(programIndex);
+}
+
+//Documented in .h
+void fused_SPO_JPO(const DecodedInstruction *exe)
+{
+    registers[exe->reg] = programIndex-1;
+    programIndex = registers[exe[1].reg];
+    InstructionCache_Redirect(programIndex);
+}
@@ -6,7 +6,10 @@
 #ifndef INSTRUCTIONHANDLERS_H
 #define	INSTRUCTIONHANDLERS_H
 
+#include <stdbool.h>
 #include "Instruction.h"
+#include "ProgramStore.h"
+#include "Scheduler.h"
 
 
 /**
@@ -16,10 +19,85 @@
 void InstructionHandlers_INIT();
 
 /**
-* @brief Processes the data stored in the current instruction and sets the data type processed.
-* @details The datatype can be used by the functions to determine if the data provided has the right format.
+* @brief Stores the state of the running program context (program index, register pointer, cursor and last wait)
+* @param context The context the state is written to
 */
-void InstructionHandlers_ProcessData(Instruction *exe);
+void InstructionHandlers_SaveContext(ProgramContext *context);
+
+/**
+* @brief Restores the state of a program context saved by InstructionHandlers_SaveContext()
+* @param context The context to be restored
+*/
+void InstructionHandlers_LoadContext(const ProgramContext *context);
+
+/**
+* @brief Returns the slot requested by a CHN instruction since the last call
+* @param slot Receives the requested slot
+* @return false if no CHN instruction has been executed
+*/
+bool InstructionHandlers_TakeChain(uint8_t *slot);
+
+/**
+* @brief Returns the values of the 100 registers (read and written directly by the translated program, see NativeCode.h)
+*/
+uint16_t* InstructionHandlers_GetRegisters(void);
+
+/**
+* @brief Returns the register chosen by PIC
+*/
+uint8_t InstructionHandlers_GetRegPointer(void);
+
+/**
+* @brief Chooses a register like PIC (used when the translated program hands over to the handlers)
+* @param pointer The register (0-99)
+*/
+void InstructionHandlers_SetRegPointer(uint8_t pointer);
+
+/**
+* @brief Decodes the data stored in an instruction into the form used by the instruction handlers.
+* @details Register numbers (R0-R99) and numbers (0-999) are converted into binary values, all other data is kept as characters.
+* For BEG the position of the matching END is stored (requires InstructionHandlers_PrepareProgram() to have been called).
+* @param in The instruction to be decoded
+* @param position Position of the instruction in the program
+* @param out The decoded instruction
+* @return true if the function number exists and the data has the format expected by the function
+*/
+bool InstructionHandlers_Decode(const Instruction *in, uint16_t position, DecodedInstruction *out);
+
+/**
+ * @brief Maximum number of faulty lines reported by InstructionHandlers_PrepareProgram()
+ */
+#define MAX_FAULTY_LINES 16
+
+/**
+* @brief Verifies the whole program once and matches every BEG to its END.
+* @details All stored instructions are scanned, because jumps may lead behind an empty instruction (which ends the
+* program only where it is executed). Every instruction is checked for
+* - a function number that exists,
+* - data in the format expected by the function and within its limit (e.g. register R0-R99, ADC channel 0-8, button 0-3),
+* - a jump target inside the program (JUM, THR),
+* - a matching partner (BEG and END).
+*
+* All faulty lines are reported in one pass, so the handlers don't have to check anything during execution.
+* Every BEG is matched to its END, so a false condition can jump behind the block without searching the EEPROM.
+* Only the blocks beyond the first 64 or nested deeper than 16 are searched for their END when they are decoded.
+* If the slot and the checksum of the program (see ProgramStore_GetChecksum()) are the same as at the last check without faults, the check is skipped.
+* @param programLength Is set to the number of stored instructions
+* @param faultyLines Is filled with the positions of the faulty instructions in ascending order (at most MAX_FAULTY_LINES)
+* @return Number of faulty instructions written into faultyLines (0 if the program is valid)
+* @warning Must be called everytime the program switches into executing mode, before the first instruction is executed
+*/
+uint8_t InstructionHandlers_PrepareProgram(uint16_t *programLength, uint16_t faultyLines[MAX_FAULTY_LINES]);
+
+
+
+/**
+* @brief Marks all pairs of instructions listed in definedFusions[] so they are executed as one fused instruction.
+* @details Only the first instruction of a pair is changed. Jumping onto the second instruction still executes it on its own.
+* @param line Decoded instructions following each other in the program
+* @param count Number of instructions in line
+*/
+void InstructionHandlers_Fuse(DecodedInstruction line[], uint8_t count);
 
 
 
@@ -27,16 +105,20 @@ void InstructionHandlers_ProcessData(Instruction *exe);
 
 
 
-/** @brief Handler for the instructions EMP, BEG and END. Does nothing. 
+/** @brief Handler for the instruction EMP. Ends the program (or the thread) as if its end had been reached.
 */
-void op_EMP_BEG_END(Instruction *exe);
+void op_EMP(const DecodedInstruction *exe);
+
+/** @brief Handler for the instructions BEG and END. Does nothing. 
+*/
+void op_BEG_END(const DecodedInstruction *exe);
     
 
 
 /** @brief Handler for the instruction PIC. 
   * @details Sets the register pointer to the desired value specified in the data of the instruction.
  */
-void op_PIC(Instruction *exe);
+void op_PIC(const DecodedInstruction *exe);
     
 
 
@@ -44,7 +126,7 @@ void op_PIC(Instruction *exe);
   * @details Sets the value of the register pointed to by the register pointer
   * to the value specified in the data of the instruction.
  */
-void op_SET(Instruction *exe);
+void op_SET(const DecodedInstruction *exe);
     
 
 
@@ -52,7 +134,7 @@ void op_SET(Instruction *exe);
   * @details Increments or decrements the register pointed to by the register pointer
   * by the value specified in the data of the instruction.
  */
-void op_INC_DEC(Instruction *exe);
+void op_INC_DEC(const DecodedInstruction *exe);
     
 
 
@@ -60,7 +142,7 @@ void op_INC_DEC(Instruction *exe);
   * @details Copies the register pointed to by the register pointer into
   * the register specified by the data of the instruction.
  */
-void op_COP(Instruction *exe);
+void op_COP(const DecodedInstruction *exe);
     
 
 
@@ -68,14 +150,14 @@ void op_COP(Instruction *exe);
   * @details Adds or subtracts the value of the register specified by the data of the instruction from/to
   * the register pointed to by the register pointer.
  */
-void op_ADD_SUB(Instruction *exe);
+void op_ADD_SUB(const DecodedInstruction *exe);
     
 
 /** @brief Handler for the instructions SMA and BIG. 
   * @details Determines, if the value of the register pointed to by the register pointer is
   * smaller or bigger then the value of the register specified by the data of the instruction.
  */
- void op_SMA_BIG(Instruction *exe);
+ void op_SMA_BIG(const DecodedInstruction *exe);
     
 
 
@@ -83,7 +165,7 @@ void op_ADD_SUB(Instruction *exe);
   * @details Determines, if the values of the register pointed to by the register pointer and
   * the value of the register specified by the data of the instruction are equal or not equal.
  */
-void op_REQ_RNQ(Instruction *exe);
+void op_REQ_RNQ(const DecodedInstruction *exe);
 
 
 
@@ -91,7 +173,7 @@ void op_REQ_RNQ(Instruction *exe);
   * @details Determines, if the values of the register pointed to by the register pointer and
   * the value of the data of the instruction are equal or not equal.
  */
-void op_VEQ_VNQ(Instruction *exe);
+void op_VEQ_VNQ(const DecodedInstruction *exe);
 
 
 
@@ -100,7 +182,7 @@ void op_VEQ_VNQ(Instruction *exe);
   * the value of the analog input provided by the data of the instuction are smaller or bigger.
   * @warning The value passed in the instruction is the ADC number of the analog input.
  */
-void op_ANH_ANL(Instruction *exe);
+void op_ANH_ANL(const DecodedInstruction *exe);
     
 
 
@@ -108,15 +190,34 @@ void op_ANH_ANL(Instruction *exe);
   * @details Determines, if the values of the register pointed to by the register pointer and
   * the value of the register specified by the data of the instruction are equal or not equal.
  */
-void op_SVA(Instruction *exe);
+void op_SVA(const DecodedInstruction *exe);
     
 
 
 /** @brief Handler for the instructions INH and INL. 
   * @details Determines, if the input specified by the data of the instruction is high or low.
+  * The inputs are debounced in the background, so the instruction returns immediately.
   * @warning Input0 = Button1, Input1 = Button2, Input2 = Button3, Input3 = Button4
  */
-void op_INH_INL(Instruction *exe);
+void op_INH_INL(const DecodedInstruction *exe);
+
+
+
+/** @brief Handler for the instruction PRS.
+  * @details Determines, if the input specified by the data of the instruction has been pressed since the last PRS
+  * or WFP for this input. Short presses between two tests are not lost.
+  * @warning Input0 = Button1, Input1 = Button2, Input2 = Button3, Input3 = Button4
+ */
+void op_PRS(const DecodedInstruction *exe);
+
+
+
+/** @brief Handler for the instruction WFP.
+  * @details Waits until the input specified by the data of the instruction is pressed (continues immediately
+  * if it has been pressed since the last PRS or WFP for this input). The program context sleeps while waiting.
+  * @warning Input0 = Button1, Input1 = Button2, Input2 = Button3, Input3 = Button4
+ */
+void op_WFP(const DecodedInstruction *exe);
     
 
 
@@ -125,7 +226,7 @@ void op_INH_INL(Instruction *exe);
   * @warning The tone must be provided in the following format: C#7, where C is any tone (C, D, E, F, G, A, H),
   * 7 is the pitch (choose from 1-7) and # indicates the semitone higher then C. # is optional.
  */
-void op_TON(Instruction *exe);
+void op_TON(const DecodedInstruction *exe);
     
 
 
@@ -133,7 +234,7 @@ void op_TON(Instruction *exe);
   * @details Prints the value of the register provided by the data of the instruction to the cursor position
   * and increments the cursor position.
  */
-void op_PTR(Instruction *exe);
+void op_PTR(const DecodedInstruction *exe);
     
 
 
@@ -141,21 +242,22 @@ void op_PTR(Instruction *exe);
   * @details Prints any three chars provided by the data of the instruction to the cursor position
   * and increments the cursor position. Chars which are not provided will be left out.
  */
-void op_PCH(Instruction *exe);
+void op_PCH(const DecodedInstruction *exe);
     
 
 
 /** @brief Handler for the instruction CLR. 
   * @details Clears the screen.
  */
-void op_CLR(Instruction *exe);
+void op_CLR(const DecodedInstruction *exe);
     
 
 
 /** @brief Handler for the instruction WAI. 
   * @details Pauses the program for the amount of time given in the data of the instruction in 1/10 seconds.
+  * The program is suspended (see Scheduler_Suspend()), so the CPU sleeps until the time has passed.
  */
-void op_WAI(Instruction *exe);
+void op_WAI(const DecodedInstruction *exe);
     
 
 
@@ -163,7 +265,7 @@ void op_WAI(Instruction *exe);
   * @brief Handler for the instruction SPO.
   * @details Saves the current position in the program to the register specified by the instruction's data.
 */
-void op_SPO(Instruction *exe);
+void op_SPO(const DecodedInstruction *exe);
     
 
 
@@ -171,7 +273,7 @@ void op_SPO(Instruction *exe);
   * @brief Handler for the instruction JPO.
   * @details Jumps to the position pointed to by the register specified by the instruction's data.
 */
-void op_JPO(Instruction *exe);
+void op_JPO(const DecodedInstruction *exe);
     
 
 
@@ -179,7 +281,7 @@ void op_JPO(Instruction *exe);
   * @brief Handler for the instruction JUM.
   * @details Jumps to the position specified in the instruction's data.
 */
-void op_JUM(Instruction *exe);
+void op_JUM(const DecodedInstruction *exe);
     
 
 
@@ -188,7 +290,71 @@ void op_JUM(Instruction *exe);
   * @details Sets one of the LEDs (depending on LD1/LD2) to the colour specified by the instruction's data.
   * (R = Red, G = Green, B = Blue, O = Orange, T = Turquoise, V = Violett, W = White, Any other = OFF)
 */
-void op_LD1_LD2(Instruction *exe);
+void op_LD1_LD2(const DecodedInstruction *exe);
+
+
+
+/** @brief Handler for the instruction THR.
+  * @details Starts a new program context at the position given in the data of the instruction.
+  * Both contexts run at the same time and share the registers (see Scheduler.h). Does nothing if all contexts are in use.
+ */
+void op_THR(const DecodedInstruction *exe);
+
+
+
+/** @brief Handler for the instruction YLD.
+  * @details Lets the other program contexts run before the program continues. No data needed.
+ */
+void op_YLD(const DecodedInstruction *exe);
+
+
+
+/** @brief Handler for the instruction CHN.
+  * @details Ends all program contexts and continues with the first instruction of the program slot given in the
+  * data of the instruction (0 to PROGRAMSTORE_SLOTS-1, see InstructionHandlers_TakeChain()). The registers are kept,
+  * so they can pass values to the next program.
+ */
+void op_CHN(const DecodedInstruction *exe);
+
+
+
+/**
+  * @brief Fused handler for PIC followed by SET.
+  * @details Sets the register pointer and the value of the chosen register at once.
+*/
+void fused_PIC_SET(const DecodedInstruction *exe);
+
+
+
+/**
+  * @brief Fused handler for PIC followed by any register command.
+  * @details Sets the register pointer and calls the handler of the second instruction directly.
+*/
+void fused_PIC(const DecodedInstruction *exe);
+
+
+
+/**
+  * @brief Fused handler for a condition followed by BEG.
+  * @details Evaluates the condition and, if it is true, steps over BEG instead of executing it.
+*/
+void fused_Condition_BEG(const DecodedInstruction *exe);
+
+
+
+/**
+  * @brief Fused handler for SPO followed by JUM.
+  * @details Saves the current position and jumps to the position specified in the second instruction's data.
+*/
+void fused_SPO_JUM(const DecodedInstruction *exe);
+
+
+
+/**
+  * @brief Fused handler for SPO followed by JPO.
+  * @details Saves the current position and jumps to the position stored in the register specified by the second instruction.
+*/
+void fused_SPO_JPO(const DecodedInstruction *exe);
 
 
 
@@ -227,6 +393,11 @@ typedef enum {
     FUNCTION_JUM,
     FUNCTION_LD1,
     FUNCTION_LD2,
+    FUNCTION_THR,
+    FUNCTION_YLD,
+    FUNCTION_PRS,
+    FUNCTION_WFP,
+    FUNCTION_CHN,
     //ADD your own here
     Function_t_MAX
 } Function_t;
@@ -234,7 +405,7 @@ typedef enum {
 /**
 * Defines a type for the instruction handlers.
 */
-typedef void (*InstructionHandler)(Instruction *exe);
+typedef void (*InstructionHandler)(const DecodedInstruction *exe);
 
 /**
  * @brief Struct which allows for allocating a function number to a function identifier
@@ -250,46 +421,48 @@ typedef struct {
   */
   InstructionHandler handler;
 
-    
+  /**
+  * @brief The data format the function expects (checked once by InstructionHandlers_PrepareProgram())
+  */
+  Instruction_DataType_t operand;
+
+  /**
+  * @brief Register numbers and numbers given as data must be smaller than this (0 = no limit)
+  */
+  uint16_t limit;
 } FunctionDefinition;
 
 /**
- * @brief All function numbers and allocated function identifiers
+ * @brief All function numbers and allocated function identifiers (defined in InstructionHandlers.c)
+ */
+extern const FunctionDefinition definedFunctions[Function_t_MAX];
+
+/**
+ * @brief Struct which allows for executing two instructions following each other as one
+ * @details The fused handler receives the first instruction, the second one directly follows it in memory.
+ * It must keep the program index (programIndex) exactly as if both instructions had been executed on their own.
+ */
+typedef struct {
+  /**
+    * @brief Function number of the first instruction
+    */
+  Function_t first;
+
+  /**
+    * @brief Function number of the second instruction
+    */
+  Function_t second;
+
+  /**
+  * @brief The handler that is called instead of the first instruction's handler
+  */
+  InstructionHandler handler;
+} FusionDefinition;
+
+/**
+ * @brief All pairs of instructions that are fused (defined in InstructionHandlers.c, the first matching entry is used)
  */
-static const FunctionDefinition definedFunctions[] = {
-  [FUNCTION_EMP] = {{ ' ', ' ', ' ' }, op_EMP_BEG_END},
-  [FUNCTION_PIC] = {{ 'P', 'I', 'C' }, op_PIC},
-  [FUNCTION_SET] = {{ 'S', 'E', 'T' }, op_SET},
-  [FUNCTION_INC] = {{ 'I', 'N', 'C' }, op_INC_DEC},
-  [FUNCTION_DEC] = {{ 'D', 'E', 'C' }, op_INC_DEC},
-  [FUNCTION_COP] = {{ 'C', 'O', 'P' }, op_COP},
-  [FUNCTION_ADD] = {{ 'A', 'D', 'D' }, op_ADD_SUB},
-  [FUNCTION_SUB] = {{ 'S', 'U', 'B' }, op_ADD_SUB},
-  [FUNCTION_SMA] = {{ 'S', 'M', 'A' }, op_SMA_BIG},
-  [FUNCTION_BIG] = {{ 'B', 'I', 'G' }, op_SMA_BIG},
-  [FUNCTION_REQ] = {{ 'R', 'E', 'Q' }, op_REQ_RNQ},
-  [FUNCTION_RNQ] = {{ 'R', 'N', 'Q' }, op_REQ_RNQ},
-  [FUNCTION_VEQ] = {{ 'V', 'E', 'Q' }, op_VEQ_VNQ},
-  [FUNCTION_VNQ] = {{ 'V', 'N', 'Q' }, op_VEQ_VNQ},
-  [FUNCTION_ANH] = {{ 'A', 'N', 'H' }, op_ANH_ANL},
-  [FUNCTION_ANL] = {{ 'A', 'N', 'L' }, op_ANH_ANL},
-  [FUNCTION_SVA] = {{ 'S', 'V', 'A' }, op_SVA},
-  [FUNCTION_INH] = {{ 'I', 'N', 'H' }, op_INH_INL},
-  [FUNCTION_INL] = {{ 'I', 'N', 'L' }, op_INH_INL},
-  [FUNCTION_TON] = {{ 'T', 'O', 'N' }, op_TON},
-  [FUNCTION_PTR] = {{ 'P', 'T', 'R' }, op_PTR},
-  [FUNCTION_PCH] = {{ 'P', 'C', 'H' }, op_PCH},
-  [FUNCTION_CLR] = {{ 'C', 'L', 'R' }, op_CLR},
-  [FUNCTION_BEG] = {{ 'B', 'E', 'G' }, op_EMP_BEG_END},
-  [FUNCTION_END] = {{ 'E', 'N', 'D' }, op_EMP_BEG_END},
-  [FUNCTION_WAI] = {{ 'W', 'A', 'I' }, op_WAI},
-  [FUNCTION_SPO] = {{ 'S', 'P', 'O' }, op_SPO},
-  [FUNCTION_JPO] = {{ 'J', 'P', 'O' }, op_JPO},
-  [FUNCTION_JUM] = {{ 'J', 'U', 'M' }, op_JUM},
-  [FUNCTION_LD1] = {{ 'L', 'D', '1' }, op_LD1_LD2},
-  [FUNCTION_LD2] = {{ 'L', 'D', '2' }, op_LD1_LD2}
-  //Add your own here
-};
+extern const FusionDefinition definedFusions[];
     
 
 
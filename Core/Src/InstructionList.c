@@ -2,60 +2,41 @@
  * @file InstructionList.c
  * @brief Implementation of the main program logic for writing and executing commands
  * @details To add your own functions to the system, first insert FUNCTION_XXX into the typedef enum at the end of the file,
- * then add the function to "definedFunctions[]" using the FUNCTION_XXX you just put in above as well as a function Identifier (normally this is the XXX).
+ * then add the function to "definedFunctions[]" in InstructionHandlers.c using the FUNCTION_XXX you just put in above as well as a function Identifier (normally this is the XXX).
  * Then go on and add the function handler to definedFunctions[]. The function handler must then be defined in InstructionHandlers.h
  * and implemented in InstructionHandlers.c.
  */
 
-#include "EEPROM.h"
+#include "I2CBus.h"
 #include "Instruction.h"
+#include "InstructionCache.h"
+#include "NativeCode.h"
+#include "ProgramStore.h"
 #include "PS2Driver.h"
 #include "InstructionList.h"
+#include "Scheduler.h"
 #include "STM_FUNCTIONS.h"
 
+/**
+ * @brief Time (in ms) without a key press after which the edited instructions are written into the EEPROM
+ */
+#define FLUSH_DELAY 1000
+
 /**
  * @brief Current position in the programm (both used in programming and executing)
  */
 uint16_t programIndex = 0;
 
 /**
- * @brief Empty instruction (is inserted when an instruction is deleted)
+ * @brief Empty instruction (is inserted by the insert key)
  */
 Instruction emptyInstruction = {0,0,0,0};
 
-
-/**
-  * @brief Deletes the instruction at the given position
-  * @param pPos Position of the instruction
-  */
-static void InstructionList_RemoveInstruction(uint8_t pPos)
-{
-    for(int i = pPos; i < 0xFF0; i++)
-    {
-    	Instruction in = EEPROM_GetInstruction(i+1);
-    	EEPROM_PutInstruction(in,i);
-    	if(in.functionNumber == FUNCTION_EMP) break;
-    }
-}
-
-
 /**
-  * @brief Inserts an instruction at the given position
-  * @param pPos Position at which to insert the instruction
-  */
-static void InstructionList_InsertEmpty(uint8_t pPos)
-{
-	int firstEmpty = 0;
-	while(EEPROM_GetFunctionNumber(firstEmpty) != FUNCTION_EMP){firstEmpty++;}
-    for(int i = firstEmpty; i > pPos; i--)
-    {
-    	Instruction in = EEPROM_GetInstruction(i-1);
-		EEPROM_PutInstruction(in,i);
-    }
+ * @brief Marks the slots whose blocks have been verified since switching into executing mode (one bit per slot)
+ */
+static uint8_t verifiedSlots = 0;
 
-    EEPROM_PutInstruction(emptyInstruction, pPos);
-
-}
 
 /**
   * @brief Writes the 3-character identifier of a given instruction into a char-array
@@ -113,7 +94,7 @@ static void InstructionList_WriteInstructions(Instruction i1, Instruction i2, ui
   */
 static void InstructionList_UpdateInstructions()
 {
-	InstructionList_WriteInstructions(EEPROM_GetInstruction(programIndex-(programIndex != 0)),EEPROM_GetInstruction(programIndex+1-(programIndex != 0)),programIndex-(programIndex != 0));
+	InstructionList_WriteInstructions(ProgramStore_GetInstruction(programIndex-(programIndex != 0)),ProgramStore_GetInstruction(programIndex+1-(programIndex != 0)),programIndex-(programIndex != 0));
 	Display_LeftArrow(3*(programIndex != 0));
 }
 
@@ -139,15 +120,102 @@ static uint8_t InstructionList_CharsToFunctionNumber(char chars[3])
 
 
 /**
-  * @brief Executes the function of the instruction pointed to by the index (programIndex)
+ * @brief Number of instructions executed since the device was last switched into executing mode
+ */
+static uint32_t executedInstructions = 0;
+
+/**
+ * @brief Time (in ms) spent executing instructions since the device was last switched into executing mode
+ */
+static uint32_t executionTime = 0;
+
+/**
+  * @brief Executes the instructions of the running context beginning at the index (programIndex) until the end of the
+  program is reached, the context is suspended by WAI or yields or the device is switched into programming mode
+  * @details The program has been checked by InstructionHandlers_PrepareProgram(), so the instructions are dispatched
+  without any further checks. The loop itself only checks the mode flag, the end of the program and the context switch flag.
+  Translated instructions (see NativeCode.h) are executed by their machine code, which returns to the loop at every
+  instruction that has to be executed by its handler.
+  * @param programLength Number of instructions in the program
+  */
+static void InstructionList_Run(uint16_t programLength)
+{
+	uint32_t count = 0;
+	uint32_t startTick = HAL_GetTick();
+
+	while(!isProgrammingMode() && programIndex < programLength && !Scheduler_IsSwitchPending())
+	{
+		if(NativeCode_Execute(&count))
+			continue;
+
+		uint16_t position = programIndex++;
+		const DecodedInstruction *exe = InstructionCache_GetInstruction(position);
+		if(exe->fusion)
+		{
+			//Like in the translated code, a BEG skipped together with its block is not counted
+			bool beg = exe[1].functionNumber == FUNCTION_BEG;
+			definedFusions[exe->fusion - 1].handler(exe);
+			if(!beg || programIndex == position + 2)
+				count++;
+		}
+		else
+			definedFunctions[exe->functionNumber].handler(exe);
+		count++;
+	}
+
+	executedInstructions += count;
+	executionTime += HAL_GetTick() - startTick;
+}
+
+
+/**
+  * @brief Shows the selected program slot and its name
   */
-static void InstructionList_ExecuteNext() {
-	Instruction exe = EEPROM_GetInstruction(programIndex);
-	programIndex++;
-	InstructionHandlers_ProcessData(&exe);
-	definedFunctions[exe.functionNumber].handler(&exe);
+static void InstructionList_ShowSlot(void)
+{
+	char name[3];
+	ProgramStore_GetName(name);
+	Display_ShowSlot(ProgramStore_GetSlot(), name);
 }
 
+/**
+  * @brief Checks the program of the selected slot and prepares its execution
+  * @details The CRCs of the blocks are only checked the first time a slot is prepared in executing mode,
+  * so chaining between slots doesn't read the whole program again. The program is executed from its copy and its
+  * translation in the flash if they are up to date (see InstructionCache_UseFlash() and NativeCode_Translate()).
+  * @param programLength Is set to the number of instructions to be executed
+  * @param install true to rewrite the copy and the translation in the flash if they belong to another program (false
+  * when chaining, so slots chaining to each other don't wear out the flash)
+  * @return false if the program is damaged or faulty (the first line of every damaged block or the faulty lines
+  * are shown until the device is switched into programming mode)
+  */
+static bool InstructionList_PrepareSlot(uint16_t *programLength, bool install)
+{
+    InstructionCache_Invalidate();
+
+    uint16_t faultyLines[MAX_FAULTY_LINES];
+    uint8_t faultyCount = 0;
+    uint8_t slot = ProgramStore_GetSlot();
+    if(!(verifiedSlots & (1 << slot)))
+    {
+        faultyCount = ProgramStore_Verify(faultyLines, MAX_FAULTY_LINES);
+        if(faultyCount == 0)
+            verifiedSlots |= 1 << slot;
+    }
+    if(faultyCount == 0)
+        faultyCount = InstructionHandlers_PrepareProgram(programLength, faultyLines);
+    if(faultyCount > 0)
+    {
+        Display_ShowFaultyLines(faultyLines, faultyCount);
+        return false;
+    }
+
+    //BEG instructions decoded during the check did not know their END yet
+    InstructionCache_Invalidate();
+    InstructionCache_UseFlash(*programLength, install);
+    NativeCode_Translate(*programLength, install);
+    return true;
+}
 
 //Documented in .h
 void InstructionList_ProgrammingMode(void)
@@ -161,9 +229,9 @@ void InstructionList_ProgrammingMode(void)
     STM_SetLED(FUNCTION_LD2, 'A');
     Display_ShowProgrammingMessage();
 
-    programIndex = 0;
-    while((programIndex < 0x0FF0) && !(EEPROM_GetFunctionNumber(programIndex) == FUNCTION_EMP))
-        programIndex++;
+    if(!ProgramStore_Load())
+        Display_ShowProgramTooLongMessage();
+    programIndex = ProgramStore_GetEnd();
 
     Display_FillBlack();
     InstructionList_UpdateInstructions();
@@ -171,6 +239,8 @@ void InstructionList_ProgrammingMode(void)
     char ch = 0;
     char linePos = 6;
     char instructionKeys[] = {0,0,0,0,0,0,0};
+    bool showingStatistics = false;
+    uint32_t lastKeyTick = HAL_GetTick();
 
     while(isProgrammingMode())
     {
@@ -179,10 +249,29 @@ void InstructionList_ProgrammingMode(void)
 			ch = PS2_GetKey();
 			if(!isProgrammingMode())
 				return;
+			//The EEPROM is only written while the user pauses, so typing is not slowed down by write cycles
+			if(ch == 0 && HAL_GetTick() - lastKeyTick >= FLUSH_DELAY)
+			{
+				ProgramStore_Flush();
+				lastKeyTick = HAL_GetTick();
+			}
 		}
+		lastKeyTick = HAL_GetTick();
 		Instruction in;
-		if(ch == ']')
+		if(ch == PS2_KEY_F1)
+		{
+			Display_ShowBusStatistics();
+			showingStatistics = true;
+		}
+		else if(showingStatistics)
 		{
+			//Any other key closes the statistics
+			showingStatistics = false;
+			InstructionList_UpdateInstructions();
+		}
+		else if(ch == ']')
+		{
+			bool stored = true;
 			if(instructionKeys[0] != 0)
 			{
 				char fName[] = {instructionKeys[0],instructionKeys[1],instructionKeys[2]};
@@ -191,9 +280,17 @@ void InstructionList_ProgrammingMode(void)
 				in.data = instructionKeys[4];
 				in.data2 = instructionKeys[5];
 				in.data3 = instructionKeys[6];
-				EEPROM_PutInstruction(in,programIndex);
+				stored = ProgramStore_PutInstruction(in,programIndex);
+
+				DecodedInstruction decoded;
+				if(!stored)
+					Display_ShowMemoryFullMessage();
+				else if(!InstructionHandlers_Decode(&in, programIndex, &decoded))
+					Display_ShowErrorMessage(programIndex);
 			}
-			programIndex++;
+			//The line stays selected if it could not be stored
+			if(stored)
+				programIndex++;
 		}
 		else if(ch == '^' && programIndex > 0)
 		{
@@ -201,11 +298,30 @@ void InstructionList_ProgrammingMode(void)
 		}
 		else if(ch == '.')
 		{
-			InstructionList_InsertEmpty(programIndex);
+			//Inserting after the end of the program changes nothing
+			if(programIndex <= ProgramStore_GetLength() && !ProgramStore_InsertInstruction(emptyInstruction, programIndex))
+				Display_ShowMemoryFullMessage();
+		}
+		else if(ch == PS2_KEY_F2)
+		{
+			ProgramStore_SelectSlot((ProgramStore_GetSlot() + 1) % PROGRAMSTORE_SLOTS, true);
+			InstructionList_ShowSlot();
+			programIndex = ProgramStore_GetEnd();
+		}
+		else if(ch == PS2_KEY_F3)
+		{
+			//The typed characters become the name of the slot
+			char name[3];
+			for(uint8_t i = 0; i < sizeof(name); i++)
+			{
+				name[i] = instructionKeys[i] != 0 ? instructionKeys[i] : ' ';
+			}
+			ProgramStore_SetName(name);
+			InstructionList_ShowSlot();
 		}
 		else if(ch == ',')
 		{
-			InstructionList_RemoveInstruction(programIndex);
+			ProgramStore_RemoveInstruction(programIndex);
 		}
 		else if(ch == '<')
 		{
@@ -230,9 +346,10 @@ void InstructionList_ProgrammingMode(void)
 			}
 		}
 
-		if(ch == ']' || ch == '^' || ch == '.' || ch == ',')
+		if(ch == ']' || ch == '^' || ch == '.' || ch == ',' || ch == PS2_KEY_F1 || ch == PS2_KEY_F2 || ch == PS2_KEY_F3)
 		{
-			InstructionList_UpdateInstructions();
+			if(ch != PS2_KEY_F1)
+				InstructionList_UpdateInstructions();
 
 			for(int i = 0; i < 7; i++)
 			{
@@ -257,14 +374,63 @@ void InstructionList_ExecutingMode(void)
         return;
 
     Display_ShowExecutingMessage();
+    I2CBus_ResetStatistics();
+
+    if(!ProgramStore_Load())
+        Display_ShowProgramTooLongMessage();
+    //Holding a button while switching into executing mode selects the slot of the button
+    for(uint8_t i = 0; i < PROGRAMSTORE_SLOTS; i++)
+    {
+        if(buttonState & (1 << i))
+        {
+            ProgramStore_SelectSlot(i, true);
+            InstructionList_ShowSlot();
+            break;
+        }
+    }
 
     InstructionHandlers_INIT();
+    Scheduler_Init();
+
+    verifiedSlots = 0;
+    uint16_t programLength;
+    if(!InstructionList_PrepareSlot(&programLength, true))
+        return;
+
+    executedInstructions = 0;
+    executionTime = 0;
     while(!(isProgrammingMode()))
     {
-        if(EEPROM_GetFunctionNumber(programIndex) == FUNCTION_EMP || programIndex > 0xFF0)
+        if(Scheduler_Next())
+        {
+            InstructionList_Run(programLength);
+            uint8_t slot;
+            if(InstructionHandlers_TakeChain(&slot))
+            {
+                //CHN continues with the first instruction of the other slot in a single context
+                //(the selection is not stored, so chaining in a loop doesn't wear out the EEPROM)
+                ProgramStore_SelectSlot(slot, false);
+                if(!InstructionList_PrepareSlot(&programLength, false))
+                    return;
+                programIndex = 0;
+                Scheduler_Init();
+            }
+            else if(programIndex >= programLength && !Scheduler_IsSwitchPending())
+                Scheduler_Exit();
+        }
+        else if(!(isProgrammingMode()))
             Display_ShowTerminatedMessage();
-        else
-            InstructionList_ExecuteNext();
     }
 }
 
+//Documented in .h
+uint32_t InstructionList_GetExecutedInstructions(void)
+{
+    return executedInstructions;
+}
+
+//Documented in .h
+uint32_t InstructionList_GetExecutionTime(void)
+{
+    return executionTime;
+}
@@ -2,7 +2,7 @@
  * @file InstructionList.h
  * @brief Provides functions for the programming and execution mode to other files as well as the function identifiers.
  * @details To add your own functions to the system, first insert FUNCTION_XXX into the typedef enum, then add the function to
- * "definedFunctions[]" using the FUNCTION_XXX you just put in above as well as a function Identifier (normally this is the XXX).
+ * "definedFunctions[]" in InstructionHandlers.c using the FUNCTION_XXX you just put in above as well as a function Identifier (normally this is the XXX).
  * Then go on and add the function handler to definedFunctions[]. The function handler must then be defined in InstructionHandlers.h
  * and implemented in InstructionHandlers.c.
  */
@@ -14,17 +14,38 @@
 
 /**
   * @brief 	Allows for programming the PCD if set into programming mode. Writes instructions into EEPROM
+  * @details Pressing F1 shows how the I2C bus was used during the last execution (see Display_ShowBusStatistics()),
+  * every further press shows the next caller and any other key returns to the program.
+  * F2 switches to the next program slot (see ProgramStore_SelectSlot()), F3 names the slot with the typed characters.
   */
 void InstructionList_ProgrammingMode(void);
 
 
 /**
   * @brief Executes commands from the eeprom begining at position 0.
-  Stops only if an error occurs, an empty function is encountered or the divice is switched back into programming mode.
+  Stops only if an error occurs, an empty instruction is executed, the end of the program is reached
+  or the divice is switched back into programming mode.
+  Holding button 1-4 while switching into executing mode runs the program in slot 0-3 instead of the selected one.
+  A program whose blocks fail their CRC check (see ProgramStore_Verify()) is not executed.
   */
 void InstructionList_ExecutingMode(void);
 
 
+/**
+  * @brief Returns the number of instructions executed since the device was last switched into executing mode
+  * @details Together with InstructionList_GetExecutionTime() this gives the execution speed in instructions per second.
+  * Both instructions of a fused pair (see definedFusions[]) are counted, so the number doesn't depend on the fusion
+  * or the translation of the program (see NativeCode.h).
+  */
+uint32_t InstructionList_GetExecutedInstructions(void);
+
+
+/**
+  * @brief Returns the time (in ms) spent executing instructions since the device was last switched into executing mode
+  */
+uint32_t InstructionList_GetExecutionTime(void);
+
+
 
 
 
@@ -0,0 +1,583 @@
+/**
+ * @file NativeCode.c
+ * @brief Implementation of the translation of the program into Thumb machine code
+ * @details The NATIVE region holds a header, an entry for every position with the offset of its code, the prologue and
+ * epilogue and the code of all instructions one after another, so the code of an instruction falls through into the
+ * code of the next one. An instruction that is not translated only gets a stub returning its position, which is marked
+ * in its entry. Jumps are made with BL, which reaches the whole flash, so the size of the code of an instruction doesn't
+ * depend on the distance of its target and all offsets are known after the code has been measured once.
+ */
+
+#include <stddef.h>
+#include "InstructionCache.h"
+#include "InstructionHandlers.h"
+#include "NativeCode.h"
+#include "ProgramFlash.h"
+#include "ProgramStore.h"
+#include "Thumb.h"
+
+/**
+ * @brief Format of the translation in the flash (must be increased whenever the generated code changes)
+ */
+#define NATIVECODE_IMAGE_FORMAT 1
+
+/**
+ * @brief Number of helpers whose addresses are built into the code
+ */
+#define NATIVECODE_HELPERS (Thumb_Symbol_t_MAX - THUMB_FIRST_HELPER)
+
+/**
+ * @brief Marks an entry whose instruction is executed by its handler (the offsets of the code are even)
+ */
+#define NATIVECODE_INTERPRETED 1
+
+/**
+ * @brief Maximum number of half-words of code generated for one instruction
+ */
+#define NATIVECODE_MAX_HALFWORDS 12
+
+/**
+ * @brief Register holding the address of the registers of the program
+ */
+#define NATIVECODE_R_REGISTERS 4
+
+/**
+ * @brief Register holding twice the register pointer (the offset of the chosen register)
+ */
+#define NATIVECODE_R_POINTER 5
+
+/**
+ * @brief Register holding the address of the mode flag
+ */
+#define NATIVECODE_R_MODE 6
+
+/**
+ * @brief Register counting the executed instructions
+ */
+#define NATIVECODE_R_COUNT 7
+
+/**
+ * @brief Register used for the offset of registers which can't be addressed with an immediate offset
+ */
+#define NATIVECODE_R_OFFSET 2
+
+/**
+ * @name Encodings of the 16-bit Thumb instructions used by the translation (ARMv6-M)
+ * @{
+ */
+#define THUMB_LSLS(rd, rm, shift)	(0x0000 | (shift) << 6 | (rm) << 3 | (rd))
+#define THUMB_LSRS(rd, rm, shift)	(0x0800 | (shift) << 6 | (rm) << 3 | (rd))
+#define THUMB_ADDS(rd, rn, rm)		(0x1800 | (rm) << 6 | (rn) << 3 | (rd))
+#define THUMB_SUBS(rd, rn, rm)		(0x1A00 | (rm) << 6 | (rn) << 3 | (rd))
+#define THUMB_MOVS_IMM(rd, imm)		(0x2000 | (rd) << 8 | (imm))
+#define THUMB_CMP_IMM(rn, imm)		(0x2800 | (rn) << 8 | (imm))
+#define THUMB_ADDS_IMM(rdn, imm)	(0x3000 | (rdn) << 8 | (imm))
+#define THUMB_SUBS_IMM(rdn, imm)	(0x3800 | (rdn) << 8 | (imm))
+#define THUMB_CMP(rn, rm)			(0x4280 | (rm) << 3 | (rn))
+#define THUMB_BX(rm)				(0x4700 | (rm) << 3)
+#define THUMB_STRH(rt, rn, rm)		(0x5200 | (rm) << 6 | (rn) << 3 | (rt))
+#define THUMB_LDRH(rt, rn, rm)		(0x5A00 | (rm) << 6 | (rn) << 3 | (rt))
+#define THUMB_STR_IMM(rt, rn, imm)	(0x6000 | (imm) / 4 << 6 | (rn) << 3 | (rt))
+#define THUMB_LDR_IMM(rt, rn, imm)	(0x6800 | (imm) / 4 << 6 | (rn) << 3 | (rt))
+#define THUMB_LDRB_IMM(rt, rn, imm)	(0x7800 | (imm) << 6 | (rn) << 3 | (rt))
+#define THUMB_STRH_IMM(rt, rn, imm)	(0x8000 | (imm) / 2 << 6 | (rn) << 3 | (rt))
+#define THUMB_LDRH_IMM(rt, rn, imm)	(0x8800 | (imm) / 2 << 6 | (rn) << 3 | (rt))
+#define THUMB_LDR_SP(rt, imm)		(0x9800 | (rt) << 8 | (imm) / 4)
+#define THUMB_PUSH(list)			(0xB400 | (list))
+#define THUMB_POP(list)				(0xBC00 | (list))
+#define THUMB_B_COND(cond, skip)	(0xD000 | (cond) << 8 | (skip))
+/** @} */
+
+/**
+ * @brief Bit of LR in the register list of PUSH and of PC in the register list of POP
+ */
+#define THUMB_LINK 0x100
+
+/**
+ * @brief Defines the condition codes of the conditional branch
+ */
+typedef enum {
+	THUMB_EQ = 0,
+	THUMB_NE = 1,
+	THUMB_HS = 2,
+	THUMB_LO = 3,
+	THUMB_HI = 8,
+	THUMB_LS = 9,
+	THUMB_GE = 10,
+	THUMB_LT = 11,
+	THUMB_GT = 12,
+	THUMB_LE = 13
+} NativeCode_Condition_t;
+
+/**
+ * @brief Defines what is done with the code while the program is translated
+ */
+typedef enum {
+	NATIVECODE_MEASURE = 0,	///< Only the size of the code is determined
+	NATIVECODE_TABLE,		///< The entries are written
+	NATIVECODE_CODE			///< The code is written (the targets of the jumps are taken from the entries)
+} NativeCode_Pass_t;
+
+/**
+ * @brief Translated program stored in the flash region (see ProgramFlash.h)
+ */
+typedef struct {
+	uint16_t format;		///< NATIVECODE_IMAGE_FORMAT (erased while the translation is being written)
+	uint16_t checksum;		///< Checksum of the program (see ProgramStore_GetChecksum())
+	uint16_t length;		///< Number of instructions
+	uint8_t slot;			///< Slot of the program
+	uint8_t reserved;
+	uint16_t size;			///< Number of bytes of code
+	uint16_t reserved2;
+	uint32_t helpers[NATIVECODE_HELPERS];	///< Addresses of the helpers called by the code
+	uint16_t entries[];		///< Offset of the code of every position and the end of the program (NATIVECODE_INTERPRETED marks a stub)
+} NativeCode_Image;
+
+/**
+ * @brief Collects the code generated for one instruction
+ */
+typedef struct {
+	uint16_t code[NATIVECODE_MAX_HALFWORDS];	///< The code
+	uint8_t count;			///< Number of half-words in code
+	uint16_t offset;		///< Offset of the code inside the region
+	uint16_t epilogue;		///< Offset of the epilogue inside the region
+	uint16_t length;		///< Number of instructions in the program
+	bool link;				///< true if the entries have been written, so jumps can be linked
+} NativeCode_Emitter;
+
+/**
+ * @brief Prologue and epilogue (see Thumb.h)
+ * @details The prologue saves the state pointer with the registers of the caller, loads the state into r4-r7 and jumps
+ * to the first instruction. The epilogue is called with the position of the next instruction in r0 and writes r5 and r7 back.
+ */
+static const uint16_t routines[] = {
+	THUMB_PUSH(THUMB_LINK | 0xF1),
+	THUMB_LDR_IMM(NATIVECODE_R_REGISTERS, 0, offsetof(Thumb_State, registers)),
+	THUMB_LDR_IMM(NATIVECODE_R_MODE, 0, offsetof(Thumb_State, mode)),
+	THUMB_LDR_IMM(NATIVECODE_R_POINTER, 0, offsetof(Thumb_State, regPointer)),
+	THUMB_LSLS(NATIVECODE_R_POINTER, NATIVECODE_R_POINTER, 1),
+	THUMB_LDR_IMM(NATIVECODE_R_COUNT, 0, offsetof(Thumb_State, executed)),
+	THUMB_BX(1),
+	//Epilogue
+	THUMB_LDR_SP(1, 0),
+	THUMB_LSRS(NATIVECODE_R_POINTER, NATIVECODE_R_POINTER, 1),
+	THUMB_STR_IMM(NATIVECODE_R_POINTER, 1, offsetof(Thumb_State, regPointer)),
+	THUMB_STR_IMM(NATIVECODE_R_COUNT, 1, offsetof(Thumb_State, executed)),
+	THUMB_POP(THUMB_LINK | 0xF2)
+};
+
+/**
+ * @brief Index of the epilogue in routines[]
+ */
+#define NATIVECODE_EPILOGUE 7
+
+/**
+* @brief The current program index provided by InstructionList.h
+*/
+extern uint16_t programIndex;
+
+/**
+ * @brief Translation in the flash that is executed (NULL if the program is executed by the handlers only)
+ */
+static const NativeCode_Image *image = NULL;
+
+/**
+ * @brief State passed to the translated code
+ */
+static Thumb_State state;
+
+/**
+ * @brief Determines if programs are translated
+ */
+static bool enabled = true;
+
+
+/**
+  * @brief Returns the offset of the prologue, which follows the entries
+  * @param length Number of instructions in the program
+  */
+static uint16_t NativeCode_GetRoutines(uint16_t length)
+{
+	return offsetof(NativeCode_Image, entries) + (length + 1) * sizeof(uint16_t);
+}
+
+/**
+  * @brief Appends a half-word to the code
+  * @param e The code
+  * @param halfword The half-word
+  */
+static void NativeCode_Emit(NativeCode_Emitter *e, uint16_t halfword)
+{
+	e->code[e->count++] = halfword;
+}
+
+/**
+  * @brief Appends a BL to an address (used for jumps as well, LR is saved by the prologue)
+  * @param e The code
+  * @param target The address (the lowest bit is ignored)
+  */
+static void NativeCode_EmitBL(NativeCode_Emitter *e, uint32_t target)
+{
+	int32_t distance = (int32_t)((target & ~1u) - (Thumb_GetAddress(THUMB_CODE) + e->offset + 2 * e->count + 4));
+	uint16_t s = distance < 0;
+	uint16_t j1 = !((distance >> 23) & 1) ^ s;
+	uint16_t j2 = !((distance >> 22) & 1) ^ s;
+
+	NativeCode_Emit(e, 0xF000 | s << 10 | ((distance >> 12) & 0x3FF));
+	NativeCode_Emit(e, 0xD000 | j1 << 13 | j2 << 11 | ((distance >> 1) & 0x7FF));
+}
+
+/**
+  * @brief Appends a jump to the code of a position
+  * @param e The code
+  * @param position The position (at most the length of the program)
+  */
+static void NativeCode_EmitJump(NativeCode_Emitter *e, uint16_t position)
+{
+	uint16_t offset = 0;
+	if(e->link)
+	{
+		const NativeCode_Image *flash = ProgramFlash_GetRegion(PROGRAMFLASH_NATIVE);
+		offset = flash->entries[position] & ~NATIVECODE_INTERPRETED;
+	}
+	NativeCode_EmitBL(e, Thumb_GetAddress(THUMB_CODE) + offset);
+}
+
+/**
+  * @brief Appends code loading a constant into a register
+  * @param e The code
+  * @param rd The register
+  * @param value The constant
+  */
+static void NativeCode_EmitConstant(NativeCode_Emitter *e, uint8_t rd, uint16_t value)
+{
+	if(value <= 0xFF)
+	{
+		NativeCode_Emit(e, THUMB_MOVS_IMM(rd, value));
+		return;
+	}
+	NativeCode_Emit(e, THUMB_MOVS_IMM(rd, value >> 8));
+	NativeCode_Emit(e, THUMB_LSLS(rd, rd, 8));
+	if(value & 0xFF)
+		NativeCode_Emit(e, THUMB_ADDS_IMM(rd, value & 0xFF));
+}
+
+/**
+  * @brief Appends code loading or storing a register given by its number
+  * @param e The code
+  * @param store true = store rt into the register, false = load the register into rt
+  * @param rt The register of the CPU
+  * @param reg Number of the register (0-99)
+  */
+static void NativeCode_EmitRegister(NativeCode_Emitter *e, bool store, uint8_t rt, uint8_t reg)
+{
+	//The immediate offset reaches R0-R31
+	if(reg < 32)
+	{
+		NativeCode_Emit(e, store ? THUMB_STRH_IMM(rt, NATIVECODE_R_REGISTERS, reg * 2) : THUMB_LDRH_IMM(rt, NATIVECODE_R_REGISTERS, reg * 2));
+		return;
+	}
+	NativeCode_Emit(e, THUMB_MOVS_IMM(NATIVECODE_R_OFFSET, reg * 2));
+	NativeCode_Emit(e, store ? THUMB_STRH(rt, NATIVECODE_R_REGISTERS, NATIVECODE_R_OFFSET) : THUMB_LDRH(rt, NATIVECODE_R_REGISTERS, NATIVECODE_R_OFFSET));
+}
+
+/**
+  * @brief Appends code returning to the handlers with the position of the next instruction
+  * @param e The code
+  * @param position The position
+  */
+static void NativeCode_EmitReturn(NativeCode_Emitter *e, uint16_t position)
+{
+	NativeCode_EmitConstant(e, 0, position);
+	NativeCode_EmitBL(e, Thumb_GetAddress(THUMB_CODE) + e->epilogue);
+}
+
+/**
+  * @brief Appends the branch of a condition (see EvaluateCondition())
+  * @details If the condition is false, the next instruction is skipped or, if it is a BEG, the whole block.
+  * @param e The code
+  * @param condition Condition code meaning that the condition is true after the comparison
+  * @param position Position of the instruction
+  */
+static void NativeCode_EmitCondition(NativeCode_Emitter *e, NativeCode_Condition_t condition, uint16_t position)
+{
+	uint16_t target = position + 2;
+	if(position + 1 < e->length)
+	{
+		const DecodedInstruction *next = InstructionCache_GetInstruction(position + 1);
+		if(next->functionNumber == FUNCTION_BEG)
+			target = next->value + 1;
+	}
+	if(target > e->length)
+		target = e->length;
+
+	//Skips the BL if the condition is true
+	NativeCode_Emit(e, THUMB_B_COND(condition, 1));
+	NativeCode_EmitJump(e, target);
+}
+
+/**
+  * @brief Appends the code of an instruction
+  * @param e The code
+  * @param exe The decoded instruction
+  * @param position Position of the instruction
+  * @return false if the instruction is executed by its handler (the code has to be discarded)
+  */
+static bool NativeCode_EmitInstruction(NativeCode_Emitter *e, const DecodedInstruction *exe, uint16_t position)
+{
+	NativeCode_Emit(e, THUMB_ADDS_IMM(NATIVECODE_R_COUNT, 1));
+	switch(exe->functionNumber)
+	{
+		case FUNCTION_BEG:
+		case FUNCTION_END:
+			return true;
+
+		case FUNCTION_PIC:
+			NativeCode_Emit(e, THUMB_MOVS_IMM(NATIVECODE_R_POINTER, exe->reg * 2));
+			return true;
+
+		case FUNCTION_SET:
+			NativeCode_EmitConstant(e, 0, exe->value);
+			NativeCode_Emit(e, THUMB_STRH(0, NATIVECODE_R_REGISTERS, NATIVECODE_R_POINTER));
+			return true;
+
+		case FUNCTION_INC:
+		case FUNCTION_DEC:
+			NativeCode_Emit(e, THUMB_LDRH(0, NATIVECODE_R_REGISTERS, NATIVECODE_R_POINTER));
+			if(exe->value <= 0xFF)
+			{
+				NativeCode_Emit(e, exe->functionNumber == FUNCTION_INC ? THUMB_ADDS_IMM(0, exe->value) : THUMB_SUBS_IMM(0, exe->value));
+			}
+			else
+			{
+				NativeCode_EmitConstant(e, 1, exe->value);
+				NativeCode_Emit(e, exe->functionNumber == FUNCTION_INC ? THUMB_ADDS(0, 0, 1) : THUMB_SUBS(0, 0, 1));
+			}
+			NativeCode_Emit(e, THUMB_STRH(0, NATIVECODE_R_REGISTERS, NATIVECODE_R_POINTER));
+			return true;
+
+		case FUNCTION_COP:
+			NativeCode_Emit(e, THUMB_LDRH(0, NATIVECODE_R_REGISTERS, NATIVECODE_R_POINTER));
+			NativeCode_EmitRegister(e, true, 0, exe->reg);
+			return true;
+
+		case FUNCTION_ADD:
+		case FUNCTION_SUB:
+			NativeCode_Emit(e, THUMB_LDRH(0, NATIVECODE_R_REGISTERS, NATIVECODE_R_POINTER));
+			NativeCode_EmitRegister(e, false, 1, exe->reg);
+			NativeCode_Emit(e, exe->functionNumber == FUNCTION_ADD ? THUMB_ADDS(0, 0, 1) : THUMB_SUBS(0, 0, 1));
+			NativeCode_Emit(e, THUMB_STRH(0, NATIVECODE_R_REGISTERS, NATIVECODE_R_POINTER));
+			return true;
+
+		case FUNCTION_SMA:
+		case FUNCTION_BIG:
+		case FUNCTION_REQ:
+		case FUNCTION_RNQ:
+			NativeCode_Emit(e, THUMB_LDRH(0, NATIVECODE_R_REGISTERS, NATIVECODE_R_POINTER));
+			NativeCode_EmitRegister(e, false, 1, exe->reg);
+			NativeCode_Emit(e, THUMB_CMP(0, 1));
+			NativeCode_EmitCondition(e, exe->functionNumber == FUNCTION_SMA ? THUMB_LO : exe->functionNumber == FUNCTION_BIG ? THUMB_HI
+					: exe->functionNumber == FUNCTION_REQ ? THUMB_EQ : THUMB_NE, position);
+			return true;
+
+		case FUNCTION_VEQ:
+		case FUNCTION_VNQ:
+			NativeCode_Emit(e, THUMB_LDRH(0, NATIVECODE_R_REGISTERS, NATIVECODE_R_POINTER));
+			if(exe->value <= 0xFF)
+			{
+				NativeCode_Emit(e, THUMB_CMP_IMM(0, exe->value));
+			}
+			else
+			{
+				NativeCode_EmitConstant(e, 1, exe->value);
+				NativeCode_Emit(e, THUMB_CMP(0, 1));
+			}
+			NativeCode_EmitCondition(e, exe->functionNumber == FUNCTION_VEQ ? THUMB_EQ : THUMB_NE, position);
+			return true;
+
+		case FUNCTION_ANH:
+		case FUNCTION_ANL:
+			//The register is compared as a signed int like the value returned by STM_ReadADC()
+			NativeCode_Emit(e, THUMB_MOVS_IMM(0, exe->reg));
+			NativeCode_EmitBL(e, Thumb_GetAddress(THUMB_READADC));
+			NativeCode_Emit(e, THUMB_LDRH(1, NATIVECODE_R_REGISTERS, NATIVECODE_R_POINTER));
+			NativeCode_Emit(e, THUMB_CMP(1, 0));
+			NativeCode_EmitCondition(e, exe->functionNumber == FUNCTION_ANH ? THUMB_LT : THUMB_GT, position);
+			return true;
+
+		case FUNCTION_SVA:
+			NativeCode_Emit(e, THUMB_MOVS_IMM(0, exe->value));
+			NativeCode_EmitBL(e, Thumb_GetAddress(THUMB_READADC));
+			NativeCode_Emit(e, THUMB_STRH(0, NATIVECODE_R_REGISTERS, NATIVECODE_R_POINTER));
+			return true;
+
+		case FUNCTION_INH:
+		case FUNCTION_INL:
+		case FUNCTION_PRS:
+			NativeCode_Emit(e, THUMB_MOVS_IMM(0, exe->value));
+			NativeCode_EmitBL(e, Thumb_GetAddress(exe->functionNumber == FUNCTION_PRS ? THUMB_TAKEBUTTONPRESS : THUMB_ISINPUTHIGH));
+			NativeCode_Emit(e, THUMB_CMP_IMM(0, 0));
+			NativeCode_EmitCondition(e, exe->functionNumber == FUNCTION_INL ? THUMB_EQ : THUMB_NE, position);
+			return true;
+
+		case FUNCTION_LD1:
+		case FUNCTION_LD2:
+			NativeCode_Emit(e, THUMB_MOVS_IMM(0, exe->functionNumber));
+			NativeCode_Emit(e, THUMB_MOVS_IMM(1, (uint8_t)exe->text[0]));
+			NativeCode_EmitBL(e, Thumb_GetAddress(THUMB_SETLED));
+			return true;
+
+		case FUNCTION_SPO:
+			NativeCode_EmitConstant(e, 0, position);
+			NativeCode_EmitRegister(e, true, 0, exe->reg);
+			return true;
+
+		case FUNCTION_JUM:
+			//Every loop contains a backward jump, so the mode switch is checked there
+			if(exe->value <= position)
+			{
+				NativeCode_Emit(e, THUMB_LDRB_IMM(0, NATIVECODE_R_MODE, 0));
+				NativeCode_Emit(e, THUMB_CMP_IMM(0, 0));
+				NativeCode_Emit(e, THUMB_B_COND(THUMB_NE, 1));
+				NativeCode_EmitJump(e, exe->value);
+				NativeCode_EmitReturn(e, exe->value);
+				return true;
+			}
+			NativeCode_EmitJump(e, exe->value);
+			return true;
+
+		case FUNCTION_JPO:
+			NativeCode_EmitRegister(e, false, 0, exe->reg);
+			NativeCode_EmitBL(e, Thumb_GetAddress(THUMB_CODE) + e->epilogue);
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+/**
+  * @brief Generates the code of every instruction and of the end of the program
+  * @param length Number of instructions
+  * @param pass What is done with the code (see NativeCode_Pass_t)
+  * @return Offset behind the code (0 if it doesn't fit into the region or the flash reported an error)
+  */
+static uint16_t NativeCode_Assemble(uint16_t length, NativeCode_Pass_t pass)
+{
+	NativeCode_Emitter e = {.length = length, .epilogue = NativeCode_GetRoutines(length) + NATIVECODE_EPILOGUE * sizeof(uint16_t), .link = pass == NATIVECODE_CODE};
+	uint32_t offset = NativeCode_GetRoutines(length) + sizeof(routines);
+
+	for(uint16_t position = 0; position <= length; position++)
+	{
+		e.count = 0;
+		e.offset = offset;
+		uint16_t entry = offset;
+
+		DecodedInstruction exe;
+		if(position < length)
+			exe = *InstructionCache_GetInstruction(position);
+		if(position == length || !NativeCode_EmitInstruction(&e, &exe, position))
+		{
+			e.count = 0;
+			NativeCode_EmitReturn(&e, position);
+			entry |= NATIVECODE_INTERPRETED;
+		}
+
+		offset += e.count * sizeof(uint16_t);
+		if(offset > PROGRAMFLASH_SIZE)
+			return 0;
+		if(pass == NATIVECODE_TABLE && !ProgramFlash_Write(PROGRAMFLASH_NATIVE, offsetof(NativeCode_Image, entries) + position * sizeof(uint16_t), &entry, sizeof(entry)))
+			return 0;
+		if(pass == NATIVECODE_CODE && !ProgramFlash_Write(PROGRAMFLASH_NATIVE, e.offset, e.code, e.count * sizeof(uint16_t)))
+			return 0;
+	}
+	return offset;
+}
+
+/**
+  * @brief Writes the translated program of the selected slot into the flash region
+  * @details The code is measured before the region is erased, so a program that doesn't fit doesn't wear out the flash.
+  * The header is written last, its format first of all, so a translation interrupted by a power failure is never used.
+  * @param length Number of instructions
+  * @return false if the code doesn't fit into the region or the flash reported an error
+  */
+static bool NativeCode_WriteImage(uint16_t length)
+{
+	uint16_t end = NativeCode_Assemble(length, NATIVECODE_MEASURE);
+	if(end == 0 || !ProgramFlash_Erase(PROGRAMFLASH_NATIVE))
+		return false;
+
+	uint16_t start = NativeCode_GetRoutines(length);
+	if(!ProgramFlash_Write(PROGRAMFLASH_NATIVE, start, routines, sizeof(routines))
+			|| NativeCode_Assemble(length, NATIVECODE_TABLE) == 0 || NativeCode_Assemble(length, NATIVECODE_CODE) == 0)
+		return false;
+
+	NativeCode_Image header = {NATIVECODE_IMAGE_FORMAT, ProgramStore_GetChecksum(), length, ProgramStore_GetSlot(), 0, end - start, 0};
+	for(uint8_t i = 0; i < NATIVECODE_HELPERS; i++)
+	{
+		header.helpers[i] = Thumb_GetAddress(THUMB_FIRST_HELPER + i);
+	}
+	return ProgramFlash_Write(PROGRAMFLASH_NATIVE, offsetof(NativeCode_Image, checksum), &header.checksum, offsetof(NativeCode_Image, entries) - offsetof(NativeCode_Image, checksum))
+		&& ProgramFlash_Write(PROGRAMFLASH_NATIVE, offsetof(NativeCode_Image, format), &header.format, sizeof(header.format));
+}
+
+/**
+  * @brief Determines if the translation in the flash belongs to the selected slot and this firmware
+  * @param flash The translation
+  * @param length Number of instructions to be executed
+  */
+static bool NativeCode_IsValid(const NativeCode_Image *flash, uint16_t length)
+{
+	if(flash->format != NATIVECODE_IMAGE_FORMAT || flash->slot != ProgramStore_GetSlot()
+			|| flash->checksum != ProgramStore_GetChecksum() || flash->length != length)
+		return false;
+
+	for(uint8_t i = 0; i < NATIVECODE_HELPERS; i++)
+	{
+		if(flash->helpers[i] != Thumb_GetAddress(THUMB_FIRST_HELPER + i))
+			return false;
+	}
+	return true;
+}
+
+//Documented in .h
+bool NativeCode_Translate(uint16_t length, bool write)
+{
+	const NativeCode_Image *flash = ProgramFlash_GetRegion(PROGRAMFLASH_NATIVE);
+	bool valid = enabled && NativeCode_IsValid(flash, length);
+
+	if(enabled && !valid && write)
+		valid = NativeCode_WriteImage(length);
+
+	image = valid ? flash : NULL;
+	state.registers = Thumb_GetAddress(THUMB_REGISTERS);
+	state.mode = Thumb_GetAddress(THUMB_MODE);
+	return valid;
+}
+
+//Documented in .h
+bool NativeCode_Execute(uint32_t *count)
+{
+	if(image == NULL || programIndex >= image->length || (image->entries[programIndex] & NATIVECODE_INTERPRETED))
+		return false;
+
+	state.regPointer = InstructionHandlers_GetRegPointer();
+	state.executed = *count;
+	programIndex = Thumb_Call(NativeCode_GetRoutines(image->length), image->entries[programIndex], &state);
+	InstructionHandlers_SetRegPointer(state.regPointer);
+	InstructionCache_Redirect(programIndex);
+	*count = state.executed;
+	return true;
+}
+
+//Documented in .h
+void NativeCode_SetEnabled(bool enable)
+{
+	enabled = enable;
+}
+
+//Documented in .h
+uint16_t NativeCode_GetSize(void)
+{
+	return image != NULL ? image->size : 0;
+}
@@ -0,0 +1,59 @@
+/**
+ * @file NativeCode.h
+ * @brief Translates the program into Thumb machine code, which runs without dispatching every instruction to its handler
+ * @details The program is translated once into the NATIVE region of the flash (see ProgramFlash.h) and only translated
+ * again when its checksum changes. Register operations, comparisons together with BEG/END, jumps and the instructions
+ * calling STM_* helpers (INH, INL, PRS, ANH, ANL, SVA, LD1, LD2) are translated. Every other instruction (e.g. WAI,
+ * PTR or THR) returns to InstructionList_Run(), which executes it with its handler and continues with the translated
+ * code behind it. JPO returns as well, since its target is only known at runtime.
+ *
+ * Inside the translated code the mode switch is only checked at backward jumps, which is enough since every loop
+ * contains one. Every executed instruction is counted on its own, like both instructions of a fused pair (see
+ * definedFusions[]) are counted by InstructionList_Run().
+ * The calls into the code are made by Thumb.c on the device and emulated by the host simulator, which can compare the
+ * translated program with the interpreter (see Simulator/Src/Simulator.c).
+ */
+
+#ifndef NATIVECODE_H
+#define NATIVECODE_H
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+  * @brief Takes the translation of the program from the flash, translating the program if necessary
+  * @details The translation is identified by the slot, the checksum and the length of the program and the addresses
+  * of the helpers, so it is also made again after a firmware update. A program whose code doesn't fit into the flash
+  * region is executed by the handlers only.
+  * Must be called after InstructionHandlers_PrepareProgram(), which determines the END of every BEG.
+  * @param length Number of instructions to be executed
+  * @param write true to rewrite a translation that belongs to another program
+  * @return true if the translated code is used
+  */
+bool NativeCode_Translate(uint16_t length, bool write);
+
+
+/**
+  * @brief Executes the translated code beginning at the program index until it reaches an instruction that has to
+  * be executed by its handler, the end of the program or a backward jump while the device is in programming mode
+  * @param count Number of executed instructions (is increased by the executed instructions)
+  * @return false if the instruction at the program index has not been translated (nothing is executed)
+  */
+bool NativeCode_Execute(uint32_t *count);
+
+
+/**
+  * @brief Enables or disables the translation (enabled after a reset)
+  * @details Takes effect the next time NativeCode_Translate() is called. Used by the simulator to execute
+  * the same program with the handlers only.
+  * @param enable false to execute every instruction with its handler
+  */
+void NativeCode_SetEnabled(bool enable);
+
+
+/**
+  * @brief Returns the number of bytes of machine code in the translation used (0 if the program is not translated)
+  */
+uint16_t NativeCode_GetSize(void);
+
+
+#endif
@@ -51,6 +51,18 @@ char PS2_GetKey()
 					return('<');
 					break;
 
+		case 0x05:	//F1
+					return(PS2_KEY_F1);
+					break;
+
+		case 0x06:	//F2
+					return(PS2_KEY_F2);
+					break;
+
+		case 0x04:	//F3
+					return(PS2_KEY_F3);
+					break;
+
 		case 0x29:	//Space
 					return(' ');
 					break;
@@ -16,6 +16,21 @@ extern long keyBuffer;
  */
 extern char framePos;
 
+/**
+ * @brief Key returned for F1 (not printable, so it can't be mixed up with a typed character)
+ */
+#define PS2_KEY_F1 '\x01'
+
+/**
+ * @brief Key returned for F2
+ */
+#define PS2_KEY_F2 '\x02'
+
+/**
+ * @brief Key returned for F3
+ */
+#define PS2_KEY_F3 '\x03'
+
 /**
   * @brief  Returns the key last pressed on the keyboard and empties the buffer
   * @retval Key that has been pressed (not all keys supported. Unsupported keys result in return 0)
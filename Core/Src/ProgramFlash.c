@@ -0,0 +1,59 @@
+/**
+ * @file ProgramFlash.c
+ * @brief Implementation of the flash regions holding the copy and the translation of the program
+ */
+
+#include "main.h"
+#include "ProgramFlash.h"
+
+/**
+ * @brief Start of the region holding the copy (defined in STM32F030XX_FLASH.ld)
+ */
+extern const uint8_t _sprogram[];
+
+/**
+ * @brief Start of the region holding the translation (defined in STM32F030XX_FLASH.ld)
+ */
+extern const uint8_t _snative[];
+
+/**
+ * @brief Start of each region (in the order of ProgramFlash_Region_t)
+ */
+static const uint8_t * const regions[ProgramFlash_Region_t_MAX] = {_sprogram, _snative};
+
+//Documented in .h
+const void* ProgramFlash_GetRegion(ProgramFlash_Region_t region)
+{
+	return regions[region];
+}
+
+//Documented in .h
+bool ProgramFlash_Erase(ProgramFlash_Region_t region)
+{
+	FLASH_EraseInitTypeDef erase = {
+		.TypeErase = FLASH_TYPEERASE_PAGES,
+		.PageAddress = (uint32_t)regions[region],
+		.NbPages = PROGRAMFLASH_SIZE / FLASH_PAGE_SIZE
+	};
+	uint32_t pageError;
+
+	HAL_FLASH_Unlock();
+	HAL_StatusTypeDef status = HAL_FLASHEx_Erase(&erase, &pageError);
+	HAL_FLASH_Lock();
+	return status == HAL_OK;
+}
+
+//Documented in .h
+bool ProgramFlash_Write(ProgramFlash_Region_t region, uint16_t offset, const void *data, uint16_t size)
+{
+	const uint8_t *bytes = data;
+	HAL_StatusTypeDef status = HAL_OK;
+
+	HAL_FLASH_Unlock();
+	for(uint16_t i = 0; i + 1 < size && status == HAL_OK; i += 2)
+	{
+		status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_HALFWORD, (uint32_t)regions[region] + offset + i, bytes[i] | bytes[i + 1] << 8);
+	}
+	HAL_FLASH_Lock();
+	return status == HAL_OK;
+}
@@ -0,0 +1,59 @@
+/**
+ * @file ProgramFlash.h
+ * @brief Erases and writes the regions of the internal flash reserved for the program
+ * @details The regions take the last 2 * PROGRAMFLASH_SIZE bytes of the flash (see STM32F030XX_FLASH.ld), so they are
+ * never overwritten by the firmware. They are read like any other constant data. A page can only be erased about 1000
+ * times, so a region should only be written if its contents have to change.
+ * The host simulator keeps the regions in RAM (see Simulator/Src/SimProgramFlash.c).
+ */
+
+#ifndef SRC_PROGRAMFLASH_H_
+#define SRC_PROGRAMFLASH_H_
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Size of each region in bytes (must match the PROGRAM and NATIVE regions in STM32F030XX_FLASH.ld)
+ * @details One page each, the firmware itself needs the other 30 KB of the flash.
+ */
+#define PROGRAMFLASH_SIZE 0x400
+
+/**
+ * @brief Defines the regions reserved for the program
+ */
+typedef enum {
+	PROGRAMFLASH_COPY = 0,	///< Decoded copy of the program (see InstructionCache_UseFlash())
+	PROGRAMFLASH_NATIVE,	///< Program translated into machine code (see NativeCode.h)
+	ProgramFlash_Region_t_MAX
+} ProgramFlash_Region_t;
+
+
+/**
+  * @brief Returns the start of a region
+  * @param region The region
+  */
+const void* ProgramFlash_GetRegion(ProgramFlash_Region_t region);
+
+
+/**
+  * @brief Erases a whole region (all bytes read 0xFF afterwards)
+  * @details Takes about 20 ms per 1 KB page, during which the CPU is stalled.
+  * @param region The region
+  * @return false if the flash reported an error
+  */
+bool ProgramFlash_Erase(ProgramFlash_Region_t region);
+
+
+/**
+  * @brief Writes bytes into an erased region
+  * @details The flash is written in half-words, so the offset and the size must be even.
+  * @param region The region
+  * @param offset Offset of the first byte inside the region
+  * @param data The bytes to be written
+  * @param size Number of bytes
+  * @return false if the flash reported an error (e.g. because the half-words were not erased)
+  */
+bool ProgramFlash_Write(ProgramFlash_Region_t region, uint16_t offset, const void *data, uint16_t size);
+
+
+#endif /* SRC_PROGRAMFLASH_H_ */
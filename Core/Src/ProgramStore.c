@@ -0,0 +1,1235 @@
+/**
+ * @file ProgramStore.c
+ * @brief Implementation of the block list storing the program in the EEPROM
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include "Crc.h"
+#include "EEPROM.h"
+#include "InstructionHandlers.h"
+#include "ProgramStore.h"
+
+/**
+ * @brief Version of the layout, stored in the directory
+ */
+#define PROGRAMSTORE_VERSION 5
+
+/**
+ * @brief Number of EEPROM pages
+ */
+#define PROGRAMSTORE_PAGES (EEPROM_SIZE / EEPROM_PAGE_SIZE)
+
+/**
+ * @brief First page that can hold a block (the pages in front of it hold the directory)
+ */
+#define PROGRAMSTORE_FIRST_BLOCK 2
+
+/**
+ * @brief Link marking the last block (page 0 is never a block)
+ */
+#define PROGRAMSTORE_END 0
+
+/**
+ * @brief Number of function numbers that can be encoded (larger ones are stored as the last one, which is invalid as well)
+ */
+#define PROGRAMSTORE_FUNCTIONS 64
+
+/**
+ * @brief Form of the data of an encoded instruction, stored in the upper two bits of its first byte
+ * @details The lower six bits hold the function number. Only data that is written back exactly as typed is
+ * stored in a short form, e.g. "7" as a number but "007" as text.
+ */
+typedef enum{
+PROGRAMSTORE_TEXT = 0,		///< The three data characters follow (4 bytes)
+PROGRAMSTORE_NUMBER = 1,	///< A number from 0 to 255 without leading zeros follows (2 bytes)
+PROGRAMSTORE_REGISTER = 2,	///< The number of a register from R0 to R99 follows (2 bytes)
+PROGRAMSTORE_NONE = 3		///< No data was typed (1 byte)
+}ProgramStore_Form_t;
+
+/**
+ * @brief Entry of a program slot in the directory
+ */
+typedef struct {
+	char name[3];		///< Shown when the slot is selected
+	uint8_t first;		///< Page of the first block (PROGRAMSTORE_END if there is none)
+	uint16_t length;	///< Number of stored instructions
+	uint16_t end;		///< Position of the first empty instruction (length if there is none)
+	uint16_t checksum;	///< Sum of the CRCs of all blocks (see ProgramStore_BlockChecksum())
+	uint8_t reserved[2];
+} ProgramStore_Slot;
+
+/**
+ * @brief Directory stored at the beginning of the EEPROM
+ */
+typedef struct {
+	char magic[3];		///< Always "PCD"
+	uint8_t version;	///< PROGRAMSTORE_VERSION
+	uint8_t selected;	///< Slot used by programming and executing mode
+	uint8_t reserved[3];
+	ProgramStore_Slot slots[PROGRAMSTORE_SLOTS];
+} ProgramStore_Directory;
+
+_Static_assert(sizeof(ProgramStore_Directory) <= PROGRAMSTORE_FIRST_BLOCK * EEPROM_PAGE_SIZE, "The directory must fit in front of the first block");
+_Static_assert(offsetof(ProgramStore_Directory, slots[2]) == EEPROM_PAGE_SIZE, "An entry must not cross a page, so it is written in one write cycle");
+
+/**
+ * @brief Layout of a block in its EEPROM page
+ */
+typedef struct {
+	uint8_t next;		///< Page of the next block (PROGRAMSTORE_END for the last block)
+	uint8_t count;		///< Number of instructions used
+	uint16_t crc;		///< Checksum of the block (see ProgramStore_BlockChecksum())
+	uint8_t code[PROGRAMSTORE_BLOCK_BYTES];	///< The encoded instructions (see ProgramStore_Encode())
+} ProgramStore_Block;
+
+_Static_assert(sizeof(ProgramStore_Block) == EEPROM_PAGE_SIZE, "A block must fill exactly one EEPROM page");
+
+/**
+ * @brief Magic bytes identifying the layout
+ */
+static const char magic[3] = {'P', 'C', 'D'};
+
+/**
+ * @brief Instruction filling up the positions in front of an instruction written after the end of the program
+ */
+static const Instruction gapInstruction = {0,0,0,0};
+
+/**
+ * @brief Pages of the blocks in program order
+ */
+static uint8_t blockPages[PROGRAMSTORE_PAGES];
+
+/**
+ * @brief Number of instructions in each block (same order as blockPages)
+ */
+static uint8_t blockCounts[PROGRAMSTORE_PAGES];
+
+/**
+ * @brief Number of blocks in the list
+ */
+static uint8_t blockTotal = 0;
+
+/**
+ * @brief Directory as it has to be written into the EEPROM
+ */
+static ProgramStore_Directory directory;
+
+/**
+ * @brief Entry of the selected slot (holds the number of stored instructions, the end and the checksum)
+ */
+static ProgramStore_Slot *program = &directory.slots[0];
+
+/**
+ * @brief Selected slot (PROGRAMSTORE_SLOTS until the one stored in the directory has been read)
+ */
+static uint8_t selectedSlot = PROGRAMSTORE_SLOTS;
+
+/**
+ * @brief Marks the pages used by the blocks of all slots (one bit per page)
+ */
+static uint8_t usedPages[PROGRAMSTORE_PAGES / 8];
+
+/**
+ * @brief Page at which the search for a free page starts
+ */
+static uint8_t nextAllocation = PROGRAMSTORE_FIRST_BLOCK;
+
+/**
+ * @brief Blocks being edited (the window), written into the EEPROM by ProgramStore_Flush()
+ */
+static ProgramStore_Block window[PROGRAMSTORE_WINDOW_BLOCKS];
+
+/**
+ * @brief Page of each block in the window (PROGRAMSTORE_END if the entry is unused)
+ */
+static uint8_t windowPages[PROGRAMSTORE_WINDOW_BLOCKS];
+
+/**
+ * @brief Marks the blocks in the window that differ from the EEPROM
+ */
+static bool windowDirty[PROGRAMSTORE_WINDOW_BLOCKS];
+
+/**
+ * @brief Time of the last access to each block in the window (the least recently used block is replaced)
+ */
+static uint32_t windowUse[PROGRAMSTORE_WINDOW_BLOCKS];
+
+/**
+ * @brief Counter giving the time of the accesses to the window
+ */
+static uint32_t windowTime = 0;
+
+/**
+ * @brief Block in the window being read in the background (PROGRAMSTORE_WINDOW_BLOCKS if there is none)
+ */
+static uint8_t windowLoading = PROGRAMSTORE_WINDOW_BLOCKS;
+
+/**
+ * @brief Marks that the entry of the selected slot has changed since it was written
+ */
+static bool programDirty = false;
+
+/**
+ * @brief Set if the EEPROM holds a program of the old layout that could not be converted, nothing is written then
+ */
+static bool readOnly = false;
+
+
+/**
+  * @brief Marks a page as used or free
+  * @param page The page
+  * @param used true if a block is stored in the page
+  */
+static void ProgramStore_SetUsed(uint8_t page, bool used)
+{
+	if(used)
+		usedPages[page / 8] |= 1 << (page % 8);
+	else
+		usedPages[page / 8] &= ~(1 << (page % 8));
+}
+
+/**
+  * @brief Determines if a block of any slot is stored in a page
+  */
+static bool ProgramStore_IsUsed(uint8_t page)
+{
+	return usedPages[page / 8] & (1 << (page % 8));
+}
+
+/**
+  * @brief Returns the number of bytes taken by an encoded instruction
+  * @param first The first byte of the instruction
+  */
+static uint8_t ProgramStore_CodeSize(uint8_t first)
+{
+	switch(first >> 6)
+	{
+	case PROGRAMSTORE_TEXT:
+		return 4;
+	case PROGRAMSTORE_NONE:
+		return 1;
+	default:
+		return 2;
+	}
+}
+
+/**
+  * @brief Decodes an instruction into the characters shown by the editor
+  * @param code The encoded instruction
+  * @param in Receives the instruction
+  */
+static void ProgramStore_Decode(const uint8_t *code, Instruction *in)
+{
+	uint8_t value;
+	in->functionNumber = code[0] & (PROGRAMSTORE_FUNCTIONS - 1);
+	in->data = 0;
+	in->data2 = 0;
+	in->data3 = 0;
+	switch(code[0] >> 6)
+	{
+	case PROGRAMSTORE_TEXT:
+		in->data = code[1];
+		in->data2 = code[2];
+		in->data3 = code[3];
+		break;
+	case PROGRAMSTORE_NUMBER:
+		value = code[1];
+		if(value >= 100)
+		{
+			in->data = '0' + value / 100;
+			in->data2 = '0' + value / 10 % 10;
+			in->data3 = '0' + value % 10;
+		}
+		else if(value >= 10)
+		{
+			in->data = '0' + value / 10;
+			in->data2 = '0' + value % 10;
+		}
+		else
+			in->data = '0' + value;
+		break;
+	case PROGRAMSTORE_REGISTER:
+		value = code[1];
+		in->data = 'R';
+		if(value >= 10)
+		{
+			in->data2 = '0' + value / 10 % 10;
+			in->data3 = '0' + value % 10;
+		}
+		else
+			in->data2 = '0' + value;
+		break;
+	}
+}
+
+/**
+  * @brief Encodes an instruction in the shortest form that gives back the same characters
+  * @param in The instruction
+  * @param code Receives the encoded instruction (at most 4 bytes)
+  * @return Number of bytes written into code
+  */
+static uint8_t ProgramStore_Encode(Instruction in, uint8_t code[4])
+{
+	uint8_t function = in.functionNumber < PROGRAMSTORE_FUNCTIONS ? in.functionNumber : PROGRAMSTORE_FUNCTIONS - 1;
+	const uint8_t *text = &in.data;
+	uint8_t skip = in.data == 'R' ? 1 : 0;
+	uint16_t value = 0;
+	for(uint8_t i = skip; i < 3 && text[i] >= '0' && text[i] <= '9'; i++)
+		value = value * 10 + text[i] - '0';
+
+	code[1] = value;
+	if(in.data == 0 && in.data2 == 0 && in.data3 == 0)
+		code[0] = function | PROGRAMSTORE_NONE << 6;
+	else if(skip && value < 100)
+		code[0] = function | PROGRAMSTORE_REGISTER << 6;
+	else if(!skip && value <= 0xFF)
+		code[0] = function | PROGRAMSTORE_NUMBER << 6;
+	else
+		code[0] = function | PROGRAMSTORE_TEXT << 6;
+
+	//Data that is not written back exactly as typed is stored as text
+	Instruction decoded;
+	if(code[0] >> 6 != PROGRAMSTORE_TEXT)
+		ProgramStore_Decode(code, &decoded);
+	if(code[0] >> 6 == PROGRAMSTORE_TEXT || memcmp(&decoded.data, text, 3) != 0)
+	{
+		code[0] = function | PROGRAMSTORE_TEXT << 6;
+		memcpy(&code[1], text, 3);
+	}
+	return ProgramStore_CodeSize(code[0]);
+}
+
+/**
+  * @brief Returns the offset of an instruction inside the code of a block
+  * @param block The block
+  * @param index Index of the instruction (the number of instructions used gives the size of the code)
+  */
+static uint8_t ProgramStore_Offset(const ProgramStore_Block *block, uint8_t index)
+{
+	uint8_t offset = 0;
+	for(uint8_t i = 0; i < index && offset < PROGRAMSTORE_BLOCK_BYTES; i++)
+		offset += ProgramStore_CodeSize(block->code[offset]);
+	//Only a damaged block runs over its end
+	return offset < PROGRAMSTORE_BLOCK_BYTES ? offset : PROGRAMSTORE_BLOCK_BYTES;
+}
+
+/**
+  * @brief Decodes consecutive instructions of a block
+  * @param block The block
+  * @param index Index of the first instruction
+  * @param in Array receiving the instructions
+  * @param count Number of instructions to be decoded
+  */
+static void ProgramStore_DecodeBlock(const ProgramStore_Block *block, uint8_t index, Instruction *in, uint8_t count)
+{
+	uint8_t offset = ProgramStore_Offset(block, index);
+	for(uint8_t i = 0; i < count; i++)
+	{
+		if(offset + ProgramStore_CodeSize(block->code[offset]) > PROGRAMSTORE_BLOCK_BYTES)
+		{
+			memset(&in[i], 0, (count - i) * sizeof(Instruction));
+			return;
+		}
+		ProgramStore_Decode(&block->code[offset], &in[i]);
+		offset += ProgramStore_CodeSize(block->code[offset]);
+	}
+}
+
+/**
+  * @brief Returns the number of bytes of a block up to the end of its used instructions
+  * @param block The block
+  */
+static uint8_t ProgramStore_UsedSize(const ProgramStore_Block *block)
+{
+	return offsetof(ProgramStore_Block, code) + ProgramStore_Offset(block, block->count);
+}
+
+/**
+  * @brief Calculates the checksum of a block
+  * @details The lower half of the CRC (see Crc.h) over the page, the link, the count and the used code.
+  * The page is included, so a block written to the wrong page is detected as well. As the checksum of the program
+  * is the sum of its blocks, an edit only has to recalculate the blocks it changes.
+  * @param page Page of the block
+  * @param block The block
+  */
+static uint16_t ProgramStore_BlockChecksum(uint8_t page, const ProgramStore_Block *block)
+{
+	Crc_Start();
+	Crc_Add(&page, 1);
+	Crc_Add(&block->next, offsetof(ProgramStore_Block, crc));
+	Crc_Add(block->code, ProgramStore_Offset(block, block->count));
+	return (uint16_t)Crc_Get();
+}
+
+/**
+  * @brief Waits for the block being read into the window in the background (see ProgramStore_Prefetch())
+  */
+static void ProgramStore_Settle(void)
+{
+	if(windowLoading < PROGRAMSTORE_WINDOW_BLOCKS)
+	{
+		EEPROM_WaitForRead();
+		windowLoading = PROGRAMSTORE_WINDOW_BLOCKS;
+	}
+}
+
+/**
+  * @brief Returns the entry of the window holding a page
+  * @return The entry or PROGRAMSTORE_WINDOW_BLOCKS if the page is not in the window
+  */
+static uint8_t ProgramStore_FindWindow(uint8_t page)
+{
+	for(uint8_t i = 0; i < PROGRAMSTORE_WINDOW_BLOCKS; i++)
+	{
+		if(windowPages[i] == page)
+			return i;
+	}
+	return PROGRAMSTORE_WINDOW_BLOCKS;
+}
+
+/**
+  * @brief Returns the least recently used entry of the window that doesn't hold changes
+  * @return The entry or PROGRAMSTORE_WINDOW_BLOCKS if all entries hold changes
+  */
+static uint8_t ProgramStore_CleanWindow(void)
+{
+	uint8_t slot = PROGRAMSTORE_WINDOW_BLOCKS;
+	for(uint8_t i = 0; i < PROGRAMSTORE_WINDOW_BLOCKS; i++)
+	{
+		if(!windowDirty[i] && (slot == PROGRAMSTORE_WINDOW_BLOCKS || windowUse[i] < windowUse[slot]))
+			slot = i;
+	}
+	return slot;
+}
+
+/**
+  * @brief Returns a block for reading, taking it into the window unless all entries hold changes
+  * @details Reading never causes changes to be written, so browsing the program doesn't wear out the EEPROM.
+  * @param page Page of the block
+  * @param buffer Receives the block if it can't be taken into the window
+  * @return The block (valid until the window is changed)
+  */
+static const ProgramStore_Block* ProgramStore_ReadBlock(uint8_t page, ProgramStore_Block *buffer)
+{
+	ProgramStore_Settle();
+	uint8_t slot = ProgramStore_FindWindow(page);
+	if(slot == PROGRAMSTORE_WINDOW_BLOCKS)
+	{
+		slot = ProgramStore_CleanWindow();
+		if(slot == PROGRAMSTORE_WINDOW_BLOCKS)
+		{
+			EEPROM_ReadBytes(page * EEPROM_PAGE_SIZE, (uint8_t*)buffer, sizeof(ProgramStore_Block));
+			return buffer;
+		}
+		EEPROM_ReadBytes(page * EEPROM_PAGE_SIZE, (uint8_t*)&window[slot], sizeof(ProgramStore_Block));
+		windowPages[slot] = page;
+	}
+	windowUse[slot] = ++windowTime;
+	return &window[slot];
+}
+
+/**
+  * @brief Returns the index of a page's block in program order
+  * @return The index or PROGRAMSTORE_PAGES if the page is not part of the list
+  */
+static uint8_t ProgramStore_Order(uint8_t page)
+{
+	for(uint8_t i = 0; i < blockTotal; i++)
+	{
+		if(blockPages[i] == page)
+			return i;
+	}
+	return PROGRAMSTORE_PAGES;
+}
+
+/**
+  * @brief Returns a block from the window, taking it into the window if necessary
+  * @details If the least recently used block has to be replaced and has been changed, all changes are written first.
+  * @param page Page of the block
+  * @param load false for a new block, which is cleared instead of being read from the EEPROM
+  * @return The block in the window (valid until the next call)
+  */
+static ProgramStore_Block* ProgramStore_GetBlock(uint8_t page, bool load)
+{
+	ProgramStore_Settle();
+	uint8_t slot = 0;
+	for(uint8_t i = 0; i < PROGRAMSTORE_WINDOW_BLOCKS; i++)
+	{
+		if(windowPages[i] == page)
+		{
+			windowUse[i] = ++windowTime;
+			if(!load)
+				memset(&window[i], 0, sizeof(ProgramStore_Block));
+			return &window[i];
+		}
+		if(windowUse[i] < windowUse[slot])
+			slot = i;
+	}
+
+	if(windowDirty[slot])
+		ProgramStore_Flush();
+
+	if(load)
+		EEPROM_ReadBytes(page * EEPROM_PAGE_SIZE, (uint8_t*)&window[slot], sizeof(ProgramStore_Block));
+	else
+		memset(&window[slot], 0, sizeof(ProgramStore_Block));
+	windowPages[slot] = page;
+	windowUse[slot] = ++windowTime;
+	return &window[slot];
+}
+
+/**
+  * @brief Marks a block in the window as changed and updates the checksum of the program
+  * @param block Block returned by ProgramStore_GetBlock()
+  */
+static void ProgramStore_SetDirty(ProgramStore_Block *block)
+{
+	uint8_t slot = block - window;
+	//The stored checksum is the one counted in the checksum of the program (0 for a new block)
+	uint16_t checksum = ProgramStore_BlockChecksum(windowPages[slot], block);
+	program->checksum += checksum - block->crc;
+	block->crc = checksum;
+	windowDirty[slot] = true;
+	programDirty = true;
+}
+
+/**
+  * @brief Finds the block holding a position
+  * @details A position equal to the number of stored instructions is mapped behind the last instruction of the last block.
+  * There must be at least one block.
+  * @param position Position of the instruction
+  * @param index Receives the index of the instruction inside the block
+  * @return Index of the block in program order
+  */
+static uint8_t ProgramStore_Locate(uint16_t position, uint8_t *index)
+{
+	uint8_t block = 0;
+	while(block + 1 < blockTotal && position >= blockCounts[block])
+	{
+		position -= blockCounts[block];
+		block++;
+	}
+	*index = position;
+	return block;
+}
+
+/**
+  * @brief Links a page into the list in front of the block at the given index
+  * @details Only the link of the previous block (or the entry of the slot) is changed.
+  * @param block Index of the block in program order the page will take
+  * @param page Page to be linked in (PROGRAMSTORE_END to end the list)
+  */
+static void ProgramStore_Link(uint8_t block, uint8_t page)
+{
+	if(block == 0)
+	{
+		program->first = page;
+		programDirty = true;
+	}
+	else
+	{
+		ProgramStore_Block *previous = ProgramStore_GetBlock(blockPages[block - 1], true);
+		previous->next = page;
+		ProgramStore_SetDirty(previous);
+	}
+}
+
+/**
+  * @brief Returns a page which is not used by any slot
+  * @return The page or PROGRAMSTORE_END if the EEPROM is full
+  */
+static uint8_t ProgramStore_Allocate(void)
+{
+	if(readOnly)
+		return PROGRAMSTORE_END;
+
+	for(uint8_t tries = PROGRAMSTORE_FIRST_BLOCK; tries < PROGRAMSTORE_PAGES; tries++)
+	{
+		uint8_t page = nextAllocation;
+		nextAllocation = nextAllocation + 1 < PROGRAMSTORE_PAGES ? nextAllocation + 1 : PROGRAMSTORE_FIRST_BLOCK;
+		if(!ProgramStore_IsUsed(page))
+			return page;
+	}
+	return PROGRAMSTORE_END;
+}
+
+/**
+  * @brief Adds a block to the list kept in RAM
+  * @param block Index the block takes in program order
+  * @param page Page of the block
+  * @param count Number of instructions in the block
+  */
+static void ProgramStore_AddBlock(uint8_t block, uint8_t page, uint8_t count)
+{
+	memmove(&blockPages[block + 1], &blockPages[block], blockTotal - block);
+	memmove(&blockCounts[block + 1], &blockCounts[block], blockTotal - block);
+	blockPages[block] = page;
+	blockCounts[block] = count;
+	blockTotal++;
+	ProgramStore_SetUsed(page, true);
+}
+
+/**
+  * @brief Removes a block from the list kept in RAM
+  * @param block Index of the block in program order (must be in the window)
+  */
+static void ProgramStore_DropBlock(uint8_t block)
+{
+	//Changes of a free page don't have to be written
+	for(uint8_t i = 0; i < PROGRAMSTORE_WINDOW_BLOCKS; i++)
+	{
+		if(windowPages[i] == blockPages[block])
+		{
+			program->checksum -= window[i].crc;
+			window[i].crc = 0;
+			windowDirty[i] = false;
+			programDirty = true;
+		}
+	}
+	ProgramStore_SetUsed(blockPages[block], false);
+	memmove(&blockPages[block], &blockPages[block + 1], blockTotal - block - 1);
+	memmove(&blockCounts[block], &blockCounts[block + 1], blockTotal - block - 1);
+	blockTotal--;
+}
+
+/**
+  * @brief Fills up every block with instructions of the following blocks, freeing the blocks that become empty
+  * @details Rewrites the whole program, so it is only used when no free page is left.
+  * @return true if at least one page has been freed
+  */
+static bool ProgramStore_Compact(void)
+{
+	uint8_t total = blockTotal;
+	for(uint8_t n = 0; n + 1 < blockTotal;)
+	{
+		ProgramStore_Block *block = ProgramStore_GetBlock(blockPages[n], true);
+		ProgramStore_Block *next = ProgramStore_GetBlock(blockPages[n + 1], true);
+		uint8_t used = ProgramStore_Offset(block, block->count);
+		uint8_t moved = 0;
+		uint8_t size = 0;
+		while(moved < next->count && used + size + ProgramStore_CodeSize(next->code[size]) <= PROGRAMSTORE_BLOCK_BYTES)
+		{
+			size += ProgramStore_CodeSize(next->code[size]);
+			moved++;
+		}
+		if(moved == 0)
+		{
+			n++;
+			continue;
+		}
+
+		memcpy(&block->code[used], next->code, size);
+		block->count += moved;
+		next->count -= moved;
+		memmove(next->code, &next->code[size], PROGRAMSTORE_BLOCK_BYTES - size);
+		blockCounts[n] = block->count;
+
+		if(next->count == 0)
+		{
+			block->next = next->next;
+			ProgramStore_SetDirty(block);
+			ProgramStore_DropBlock(n + 1);
+		}
+		else
+		{
+			ProgramStore_SetDirty(block);
+			ProgramStore_SetDirty(next);
+			blockCounts[n + 1] = next->count;
+		}
+	}
+	return blockTotal < total;
+}
+
+/**
+  * @brief Writes the whole directory
+  * @details The second page is written first, so the first page, which identifies the layout, is only written
+  * once the rest of the directory is complete.
+  */
+static void ProgramStore_WriteDirectory(void)
+{
+	EEPROM_WriteBytes(EEPROM_PAGE_SIZE, (uint8_t*)&directory + EEPROM_PAGE_SIZE, sizeof(directory) - EEPROM_PAGE_SIZE);
+	EEPROM_WriteBytes(0, (uint8_t*)&directory, EEPROM_PAGE_SIZE);
+}
+
+/**
+  * @brief Writes the entry of a slot
+  * @param entry The entry in the directory
+  */
+static void ProgramStore_WriteEntry(ProgramStore_Slot *entry)
+{
+	EEPROM_WriteBytes((uint8_t*)entry - (uint8_t*)&directory, (uint8_t*)entry, sizeof(ProgramStore_Slot));
+	if(entry == program)
+		programDirty = false;
+}
+
+/**
+  * @brief Sets up a directory holding the given program in slot 0 and empty slots
+  * @param first Page of the first block of the program
+  */
+static void ProgramStore_InitDirectory(uint8_t first)
+{
+	memset(&directory, 0, sizeof(directory));
+	memcpy(directory.magic, magic, sizeof(magic));
+	directory.version = PROGRAMSTORE_VERSION;
+	for(uint8_t i = 0; i < PROGRAMSTORE_SLOTS; i++)
+	{
+		memset(directory.slots[i].name, ' ', sizeof(directory.slots[i].name));
+		directory.slots[i].first = PROGRAMSTORE_END;
+	}
+	directory.slots[0].first = first;
+	program = &directory.slots[0];
+}
+
+/**
+  * @brief Converts the old layout (the instructions one after another from address 0, ending at the first empty instruction)
+  * @details Block n is written to page n+PROGRAMSTORE_FIRST_BLOCK and only made of instructions that were stored in
+  * front of the end of that page. Writing the blocks from the last to the first therefore never overwrites an
+  * instruction that has not been copied yet. The directory is written last, because the pages in front of the
+  * first block still hold the first instructions until then. Every block is filled as far as its space and this
+  * rule allow. The number of instructions of each block is collected in blockCounts before anything is written.
+  * @return false if the program doesn't fit into the blocks (nothing has been written then)
+  */
+static bool ProgramStore_Convert(void)
+{
+	const uint8_t pageInstructions = EEPROM_PAGE_SIZE / sizeof(Instruction);
+	const uint16_t maxLength = PROGRAMSTORE_PAGES * pageInstructions;
+	Instruction in[EEPROM_PAGE_SIZE / sizeof(Instruction)];
+	uint16_t length = 0;
+	uint8_t blocks = 0;
+	//The first instruction starts a block
+	uint8_t size = PROGRAMSTORE_BLOCK_BYTES;
+	bool end = false;
+	while(!end && length < maxLength)
+	{
+		EEPROM_ReadBytes(length * sizeof(Instruction), (uint8_t*)in, sizeof(in));
+		for(uint8_t i = 0; i < pageInstructions && !end; i++)
+		{
+			if(in[i].functionNumber == FUNCTION_EMP)
+			{
+				end = true;
+				continue;
+			}
+
+			uint8_t code[sizeof(Instruction)];
+			uint8_t codeSize = ProgramStore_Encode(in[i], code);
+			if(size + codeSize > PROGRAMSTORE_BLOCK_BYTES || length >= (blocks + PROGRAMSTORE_FIRST_BLOCK) * pageInstructions)
+			{
+				if(blocks == PROGRAMSTORE_PAGES - PROGRAMSTORE_FIRST_BLOCK)
+					return false;
+				blockCounts[blocks++] = 0;
+				size = 0;
+			}
+			blockCounts[blocks - 1]++;
+			size += codeSize;
+			length++;
+		}
+	}
+
+	ProgramStore_InitDirectory(blocks > 0 ? PROGRAMSTORE_FIRST_BLOCK : PROGRAMSTORE_END);
+	program->length = length;
+	program->end = length;
+	uint16_t first = length;
+	for(uint8_t n = blocks; n > 0; n--)
+	{
+		uint8_t page = n - 1 + PROGRAMSTORE_FIRST_BLOCK;
+		ProgramStore_Block block = {0};
+		block.next = n < blocks ? page + 1 : PROGRAMSTORE_END;
+		block.count = blockCounts[n - 1];
+		first -= block.count;
+		size = 0;
+		for(uint8_t i = 0; i < block.count; i++)
+		{
+			uint8_t chunk = i % pageInstructions;
+			if(chunk == 0)
+			{
+				uint8_t count = block.count - i < pageInstructions ? block.count - i : pageInstructions;
+				EEPROM_ReadBytes((first + i) * sizeof(Instruction), (uint8_t*)in, count * sizeof(Instruction));
+			}
+			size += ProgramStore_Encode(in[chunk], &block.code[size]);
+		}
+		block.crc = ProgramStore_BlockChecksum(page, &block);
+		EEPROM_WriteBytes(page * EEPROM_PAGE_SIZE, (uint8_t*)&block, sizeof(block));
+		program->checksum += block.crc;
+	}
+
+	ProgramStore_WriteDirectory();
+	return true;
+}
+
+/**
+  * @brief Recalculates the length, the end and the checksum of a slot from its blocks
+  * @details Is needed if the power failed between writing the blocks and the entry. The entry itself is not written.
+  * A damaged block is left as it is, so ProgramStore_Verify() still detects it.
+  * @param entry The entry in the directory
+  */
+static void ProgramStore_Summarize(ProgramStore_Slot *entry)
+{
+	//A page is only followed once, so a damaged link can't cause an endless loop
+	uint8_t visited[PROGRAMSTORE_PAGES / 8] = {0};
+	uint8_t page = entry->first;
+	entry->length = 0;
+	entry->end = 0xFFFF;
+	entry->checksum = 0;
+	while(page >= PROGRAMSTORE_FIRST_BLOCK && page < PROGRAMSTORE_PAGES && !(visited[page / 8] & (1 << (page % 8))))
+	{
+		visited[page / 8] |= 1 << (page % 8);
+		ProgramStore_Block block;
+		EEPROM_ReadBytes(page * EEPROM_PAGE_SIZE, (uint8_t*)&block, sizeof(block));
+
+		uint8_t count = block.count < PROGRAMSTORE_BLOCK_BYTES ? block.count : PROGRAMSTORE_BLOCK_BYTES;
+		for(uint8_t i = 0; i < count && entry->end == 0xFFFF; i++)
+		{
+			Instruction in;
+			ProgramStore_DecodeBlock(&block, i, &in, 1);
+			if(in.functionNumber == FUNCTION_EMP)
+				entry->end = entry->length + i;
+		}
+		entry->length += count;
+		entry->checksum += block.crc;
+		page = block.next;
+	}
+	if(entry->end > entry->length)
+		entry->end = entry->length;
+}
+
+/**
+  * @brief Returns the position of the first empty instruction at or after a position
+  * @param position Position at which the search starts
+  * @return The position or the number of stored instructions if there is none
+  */
+static uint16_t ProgramStore_FindEmpty(uint16_t position)
+{
+	Instruction in[8];
+	for(; position < program->length; position += sizeof(in) / sizeof(Instruction))
+	{
+		ProgramStore_GetInstructions(in, position, sizeof(in) / sizeof(Instruction));
+		for(uint8_t i = 0; i < sizeof(in) / sizeof(Instruction) && position + i < program->length; i++)
+		{
+			if(in[i].functionNumber == FUNCTION_EMP)
+				return position + i;
+		}
+	}
+	return program->length;
+}
+
+/**
+  * @brief Counts an inserted instruction in the entry of the slot
+  * @param in The inserted instruction
+  * @param position Position of the inserted instruction
+  */
+static void ProgramStore_CountInsertion(Instruction in, uint16_t position)
+{
+	program->length++;
+	if(position <= program->end)
+		program->end = in.functionNumber == FUNCTION_EMP ? position : program->end + 1;
+	programDirty = true;
+}
+
+/**
+  * @brief Replaces, inserts or removes an instruction in the block holding a position
+  * @details The block is changed in the window. If the instructions don't fit into the block anymore, the last ones
+  * are moved into the next block if it has space for them, otherwise into a free page linked in behind the block.
+  * An emptied block is unlinked.
+  * @param position Position of the instruction (at most the number of stored instructions if nothing is removed)
+  * @param remove true to remove the instruction at the position
+  * @param in Instruction to be inserted at the position (NULL to insert nothing)
+  * @return false if the EEPROM is full (nothing has been changed then)
+  */
+static bool ProgramStore_Splice(uint16_t position, bool remove, const Instruction *in)
+{
+	if(blockTotal == 0)
+	{
+		uint8_t page = ProgramStore_Allocate();
+		if(page == PROGRAMSTORE_END)
+			return false;
+
+		ProgramStore_Block *block = ProgramStore_GetBlock(page, false);
+		block->next = PROGRAMSTORE_END;
+		block->count = 1;
+		ProgramStore_Encode(*in, block->code);
+		ProgramStore_SetDirty(block);
+		ProgramStore_Link(0, page);
+		ProgramStore_AddBlock(0, page, 1);
+		return true;
+	}
+
+	uint8_t index;
+	uint8_t n = ProgramStore_Locate(position, &index);
+	ProgramStore_Block *block = ProgramStore_GetBlock(blockPages[n], true);
+
+	//The new code of the block is put together in front of the block's space, so it may run over by one instruction
+	uint8_t code[PROGRAMSTORE_BLOCK_BYTES + sizeof(Instruction)];
+	uint8_t offset = ProgramStore_Offset(block, index);
+	uint8_t rest = ProgramStore_Offset(block, index + remove);
+	uint8_t used = ProgramStore_Offset(block, block->count);
+	uint8_t count = block->count - remove;
+	memcpy(code, block->code, offset);
+	uint8_t size = offset;
+	if(in != NULL)
+	{
+		size += ProgramStore_Encode(*in, &code[size]);
+		count++;
+	}
+	memcpy(&code[size], &block->code[rest], used - rest);
+	size += used - rest;
+
+	if(count == 0)
+	{
+		//The block becomes free by linking its predecessor to its successor
+		ProgramStore_Link(n, block->next);
+		ProgramStore_DropBlock(n);
+		return true;
+	}
+
+	//The instructions that fit stay in the block
+	uint8_t kept = 0;
+	uint8_t keptSize = 0;
+	while(kept < count && keptSize + ProgramStore_CodeSize(code[keptSize]) <= PROGRAMSTORE_BLOCK_BYTES)
+	{
+		keptSize += ProgramStore_CodeSize(code[keptSize]);
+		kept++;
+	}
+
+	if(kept < count)
+	{
+		ProgramStore_Block *next = NULL;
+		if(n + 1 < blockTotal)
+		{
+			next = ProgramStore_GetBlock(blockPages[n + 1], true);
+			if(ProgramStore_Offset(next, next->count) + size - keptSize > PROGRAMSTORE_BLOCK_BYTES)
+				next = NULL;
+		}
+
+		if(next != NULL)
+		{
+			memmove(&next->code[size - keptSize], next->code, PROGRAMSTORE_BLOCK_BYTES - (size - keptSize));
+			memcpy(next->code, &code[keptSize], size - keptSize);
+			next->count += count - kept;
+			ProgramStore_SetDirty(next);
+			blockCounts[n + 1] = next->count;
+		}
+		else
+		{
+			uint8_t page = ProgramStore_Allocate();
+			if(page == PROGRAMSTORE_END)
+			{
+				//Nothing has been changed yet, so the change is repeated on the compacted blocks
+				if(!ProgramStore_Compact())
+					return false;
+				return ProgramStore_Splice(position, remove, in);
+			}
+
+			ProgramStore_Block *split = ProgramStore_GetBlock(page, false);
+			split->next = block->next;
+			split->count = count - kept;
+			memcpy(split->code, &code[keptSize], size - keptSize);
+			block->next = page;
+			ProgramStore_SetDirty(split);
+			ProgramStore_AddBlock(n + 1, page, split->count);
+		}
+	}
+
+	memcpy(block->code, code, keptSize);
+	memset(&block->code[keptSize], 0, PROGRAMSTORE_BLOCK_BYTES - keptSize);
+	block->count = kept;
+	ProgramStore_SetDirty(block);
+	blockCounts[n] = kept;
+	return true;
+}
+
+//Documented in .h
+bool ProgramStore_Load(void)
+{
+	ProgramStore_Flush();
+	for(uint8_t i = 0; i < PROGRAMSTORE_WINDOW_BLOCKS; i++)
+	{
+		windowPages[i] = PROGRAMSTORE_END;
+		windowUse[i] = 0;
+	}
+
+	EEPROM_ReadBytes(0, (uint8_t*)&directory, sizeof(directory));
+	readOnly = false;
+	bool converted = false;
+	if(memcmp(directory.magic, magic, sizeof(magic)) != 0 || directory.version != PROGRAMSTORE_VERSION)
+	{
+		//The old program is kept as it is and all slots are shown as empty
+		converted = ProgramStore_Convert();
+		readOnly = !converted;
+		if(readOnly)
+			ProgramStore_InitDirectory(PROGRAMSTORE_END);
+	}
+	if(selectedSlot >= PROGRAMSTORE_SLOTS)
+		selectedSlot = directory.selected < PROGRAMSTORE_SLOTS ? directory.selected : 0;
+	program = &directory.slots[selectedSlot];
+	programDirty = false;
+
+	//The blocks of all slots are followed to find the free pages, only those of the selected slot are kept
+	memset(usedPages, 0, sizeof(usedPages));
+	blockTotal = 0;
+	uint16_t length = 0;
+	for(uint8_t i = 0; i < PROGRAMSTORE_SLOTS; i++)
+	{
+		uint8_t page = directory.slots[i].first;
+		//A page is only followed once, so a damaged link can't cause an endless loop
+		while(page >= PROGRAMSTORE_FIRST_BLOCK && page < PROGRAMSTORE_PAGES && !ProgramStore_IsUsed(page))
+		{
+			uint8_t link[2];
+			EEPROM_ReadBytes(page * EEPROM_PAGE_SIZE, link, sizeof(link));
+			ProgramStore_SetUsed(page, true);
+			if(&directory.slots[i] == program)
+			{
+				blockPages[blockTotal] = page;
+				blockCounts[blockTotal] = link[1] < PROGRAMSTORE_BLOCK_BYTES ? link[1] : PROGRAMSTORE_BLOCK_BYTES;
+				length += blockCounts[blockTotal];
+				blockTotal++;
+			}
+			page = link[0];
+		}
+	}
+
+	if(program->length != length || program->end > length)
+	{
+		ProgramStore_Summarize(program);
+		ProgramStore_WriteEntry(program);
+	}
+
+	//Converted blocks only hold instructions stored in front of their pages, so they are filled up once
+	if(converted && ProgramStore_Compact())
+		ProgramStore_Flush();
+	return !readOnly;
+}
+
+//Documented in .h
+void ProgramStore_Flush(void)
+{
+	ProgramStore_Settle();
+	if(readOnly)
+		return;
+
+	//From the end of the program to its beginning, so no link points to a block that has not been written yet
+	while(true)
+	{
+		uint8_t last = PROGRAMSTORE_WINDOW_BLOCKS;
+		uint8_t order = 0;
+		for(uint8_t i = 0; i < PROGRAMSTORE_WINDOW_BLOCKS; i++)
+		{
+			if(windowDirty[i] && (last == PROGRAMSTORE_WINDOW_BLOCKS || ProgramStore_Order(windowPages[i]) > order))
+			{
+				last = i;
+				order = ProgramStore_Order(windowPages[i]);
+			}
+		}
+		if(last == PROGRAMSTORE_WINDOW_BLOCKS)
+			break;
+
+		//Link, count and used instructions in one write cycle
+		EEPROM_WriteBytes(windowPages[last] * EEPROM_PAGE_SIZE, (uint8_t*)&window[last], ProgramStore_UsedSize(&window[last]));
+		windowDirty[last] = false;
+	}
+
+	if(programDirty)
+		ProgramStore_WriteEntry(program);
+}
+
+//Documented in .h
+uint8_t ProgramStore_Verify(uint16_t positions[], uint8_t max)
+{
+	ProgramStore_Flush();
+
+	uint8_t corrupted = 0;
+	uint16_t checksum = 0;
+	uint16_t position = 0;
+	for(uint8_t n = 0; n < blockTotal;)
+	{
+		//Blocks in consecutive pages are read into the window with a single sequential read
+		uint8_t run = 1;
+		while(run < PROGRAMSTORE_WINDOW_BLOCKS && n + run < blockTotal && blockPages[n + run] == blockPages[n] + run)
+			run++;
+		EEPROM_ReadBytes(blockPages[n] * EEPROM_PAGE_SIZE, (uint8_t*)window, run * sizeof(ProgramStore_Block));
+
+		for(uint8_t i = 0; i < run; i++, n++)
+		{
+			if(window[i].crc != ProgramStore_BlockChecksum(blockPages[n], &window[i]))
+			{
+				if(corrupted < max)
+					positions[corrupted] = position;
+				corrupted++;
+			}
+			checksum += window[i].crc;
+			position += blockCounts[n];
+		}
+	}
+
+	//The window has been used as buffer
+	for(uint8_t i = 0; i < PROGRAMSTORE_WINDOW_BLOCKS; i++)
+	{
+		windowPages[i] = PROGRAMSTORE_END;
+		windowUse[i] = 0;
+	}
+
+	//Intact blocks not matching the entry were written without the entry being written afterwards
+	if(corrupted == 0 && checksum != program->checksum)
+	{
+		ProgramStore_Summarize(program);
+		ProgramStore_WriteEntry(program);
+	}
+	return corrupted < max ? corrupted : max;
+}
+
+//Documented in .h
+uint8_t ProgramStore_GetSlot(void)
+{
+	return program - directory.slots;
+}
+
+//Documented in .h
+void ProgramStore_SelectSlot(uint8_t slot, bool keep)
+{
+	if(slot >= PROGRAMSTORE_SLOTS)
+		return;
+
+	ProgramStore_Flush();
+	selectedSlot = slot;
+	if(keep && slot != directory.selected && !readOnly)
+	{
+		directory.selected = slot;
+		EEPROM_WriteBytes(offsetof(ProgramStore_Directory, selected), &slot, 1);
+	}
+	ProgramStore_Load();
+}
+
+//Documented in .h
+void ProgramStore_GetName(char name[3])
+{
+	memcpy(name, program->name, sizeof(program->name));
+}
+
+//Documented in .h
+void ProgramStore_SetName(const char name[3])
+{
+	memcpy(program->name, name, sizeof(program->name));
+	programDirty = true;
+}
+
+//Documented in .h
+uint16_t ProgramStore_GetLength(void)
+{
+	return program->length;
+}
+
+//Documented in .h
+uint16_t ProgramStore_GetEnd(void)
+{
+	return program->end;
+}
+
+//Documented in .h
+uint16_t ProgramStore_GetChecksum(void)
+{
+	return program->checksum;
+}
+
+//Documented in .h
+Instruction ProgramStore_GetInstruction(uint16_t position)
+{
+	Instruction in;
+	ProgramStore_GetInstructions(&in, position, 1);
+	return in;
+}
+
+//Documented in .h
+void ProgramStore_GetInstructions(Instruction *in, uint16_t position, uint8_t count)
+{
+	if(position < program->length)
+	{
+		uint8_t index;
+		uint8_t n = ProgramStore_Locate(position, &index);
+		while(count > 0 && n < blockTotal)
+		{
+			uint8_t chunk = blockCounts[n] - index;
+			if(chunk > count)
+				chunk = count;
+
+			ProgramStore_Block buffer;
+			ProgramStore_DecodeBlock(ProgramStore_ReadBlock(blockPages[n], &buffer), index, in, chunk);
+			in += chunk;
+			count -= chunk;
+			index = 0;
+			n++;
+		}
+	}
+
+	//Everything after the end of the program is empty
+	memset(in, 0, count * sizeof(Instruction));
+}
+
+//Documented in .h
+bool ProgramStore_Prefetch(uint16_t position)
+{
+	if(position >= program->length || windowLoading < PROGRAMSTORE_WINDOW_BLOCKS)
+		return false;
+
+	uint8_t index;
+	uint8_t page = blockPages[ProgramStore_Locate(position, &index)];
+	if(ProgramStore_FindWindow(page) < PROGRAMSTORE_WINDOW_BLOCKS)
+		return true;
+
+	uint8_t slot = ProgramStore_CleanWindow();
+	if(slot == PROGRAMSTORE_WINDOW_BLOCKS)
+		return false;
+	//The entry doesn't hold a block while it is being read
+	windowPages[slot] = PROGRAMSTORE_END;
+	if(!EEPROM_StartReadBytes(page * EEPROM_PAGE_SIZE, (uint8_t*)&window[slot], sizeof(ProgramStore_Block)))
+		return false;
+	windowPages[slot] = page;
+	windowUse[slot] = ++windowTime;
+	windowLoading = slot;
+	return true;
+}
+
+//Documented in .h
+bool ProgramStore_PutInstruction(Instruction in, uint16_t position)
+{
+	while(program->length < position)
+	{
+		if(!ProgramStore_InsertInstruction(gapInstruction, program->length))
+			return false;
+	}
+	if(position == program->length)
+		return ProgramStore_InsertInstruction(in, position);
+
+	if(!ProgramStore_Splice(position, true, &in))
+		return false;
+
+	if(in.functionNumber == FUNCTION_EMP && position < program->end)
+		program->end = position;
+	else if(in.functionNumber != FUNCTION_EMP && position == program->end)
+		program->end = ProgramStore_FindEmpty(position + 1);
+	return true;
+}
+
+//Documented in .h
+bool ProgramStore_InsertInstruction(Instruction in, uint16_t position)
+{
+	if(position > program->length || !ProgramStore_Splice(position, false, &in))
+		return false;
+
+	ProgramStore_CountInsertion(in, position);
+	return true;
+}
+
+//Documented in .h
+void ProgramStore_RemoveInstruction(uint16_t position)
+{
+	if(position >= program->length)
+		return;
+
+	ProgramStore_Splice(position, true, NULL);
+	program->length--;
+	if(position < program->end)
+		program->end--;
+	else if(position == program->end)
+		program->end = ProgramStore_FindEmpty(position);
+	programDirty = true;
+}
@@ -0,0 +1,188 @@
+/**
+ * @file ProgramStore.h
+ * @brief Stores the programs in the EEPROM as linked lists of blocks, so inserting or deleting a line only rewrites one or two pages
+ * @details The EEPROM holds PROGRAMSTORE_SLOTS programs. A directory in pages 0 and 1 holds the selected slot and an
+ * entry for each slot: its name, its first block, the number of instructions, the position of the first empty
+ * instruction and a checksum of the program. The entry is updated by every edit, so neither the end of the program
+ * nor a change of it has to be found by reading the instructions. Every other page is a block: the page of
+ * the next block, the number of instructions used, a CRC of the block and PROGRAMSTORE_BLOCK_BYTES bytes of encoded
+ * instructions. The checksum of the program is the sum of the CRCs of its blocks.
+ *
+ * An instruction is encoded in 1 to 4 bytes: the function number and the form of the data in one byte, followed by
+ * a number (e.g. "255") or a register (e.g. "R12") in one byte or by the three characters if they have another form.
+ * An instruction without data takes a single byte. The functions of this file translate between the encoding and
+ * the characters typed by the user, so the rest of the program only sees instructions of 4 characters.
+ * Pages not linked into any list are free. A full block passes an instruction on to a neighbour with space or is split
+ * into a free page, an emptied block is unlinked. Only when no page is left, the blocks are compacted.
+ * New blocks are taken round-robin from the free pages, so the writes are spread over the whole EEPROM.
+ * All functions except ProgramStore_SelectSlot() work on the selected slot.
+ *
+ * ProgramStore_Load() resolves the order of the blocks into RAM, so a position is mapped to its EEPROM address without
+ * further reads. Positions at or after the end of the stored instructions read as empty instructions.
+ * EEPROM contents written in the old layout (the instructions one after another from address 0) are converted into
+ * slot 0 on the first load. A program too long for the blocks is not converted but left untouched, the slots read as
+ * empty then and no changes are stored.
+ *
+ * Edits are made in a window of PROGRAMSTORE_WINDOW_BLOCKS blocks kept in RAM, so they are shown without waiting for
+ * the EEPROM. Blocks that are only read are kept in the window as well, as long as it holds unchanged blocks. Changed blocks are written by ProgramStore_Flush() with one page write each, or when a changed block has
+ * to leave the window. Changes that have not been flushed are lost if the power fails.
+ */
+
+#ifndef PROGRAMSTORE_H
+#define PROGRAMSTORE_H
+#include <stdbool.h>
+#include <stdint.h>
+#include "Instruction.h"
+
+/**
+ * @brief Number of bytes of encoded instructions stored in one block (a block takes one EEPROM page)
+ */
+#define PROGRAMSTORE_BLOCK_BYTES 28
+
+/**
+ * @brief Number of blocks kept in RAM while editing
+ */
+#define PROGRAMSTORE_WINDOW_BLOCKS 4
+
+/**
+ * @brief Number of programs stored in the EEPROM
+ */
+#define PROGRAMSTORE_SLOTS 4
+
+
+/**
+  * @brief Reads the directory and the order of the selected slot's blocks from the EEPROM into RAM, converting an older layout if necessary
+  * @details Is called everytime the device is switched into programming or executing mode. Pending changes are flushed first.
+  * @return false if the EEPROM holds a program of the old layout that is too long to be converted
+  */
+bool ProgramStore_Load(void);
+
+
+/**
+  * @brief Writes the changed blocks of the window into the EEPROM
+  * @details The blocks are written from the end of the program to its beginning and the header last, so the list
+  * in the EEPROM never links to a block that has not been written yet.
+  */
+void ProgramStore_Flush(void);
+
+
+/**
+  * @brief Checks the CRC of every block of the selected slot
+  * @details Pending changes are flushed first. Every block is read once, blocks in consecutive pages
+  * with a single sequential read. If all blocks are intact but the power failed before the entry
+  * of the slot was written, the entry is recalculated.
+  * @param positions Is filled with the position of the first instruction of every damaged block (at most max)
+  * @param max Size of positions
+  * @return Number of damaged blocks (at most max)
+  */
+uint8_t ProgramStore_Verify(uint16_t positions[], uint8_t max);
+
+
+/**
+  * @brief Returns the selected slot (0 to PROGRAMSTORE_SLOTS-1)
+  */
+uint8_t ProgramStore_GetSlot(void);
+
+
+/**
+  * @brief Selects the slot used by all other functions and loads it
+  * @details Pending changes of the previous slot are flushed first. Only the directory and the links of the blocks
+  * are read, so switching takes a few ms.
+  * @param slot The slot (0 to PROGRAMSTORE_SLOTS-1, other values are ignored)
+  * @param keep true to store the selection in the EEPROM, so the slot stays selected after a restart
+  */
+void ProgramStore_SelectSlot(uint8_t slot, bool keep);
+
+
+/**
+  * @brief Returns the name of the selected slot
+  * @param name Receives the 3 characters of the name (spaces if it has not been named)
+  */
+void ProgramStore_GetName(char name[3]);
+
+
+/**
+  * @brief Names the selected slot
+  * @param name The 3 characters of the name
+  */
+void ProgramStore_SetName(const char name[3]);
+
+
+/**
+  * @brief Returns the number of stored instructions
+  */
+uint16_t ProgramStore_GetLength(void);
+
+
+/**
+  * @brief Returns the position of the first empty instruction (the end of the program)
+  * @return The position or the number of stored instructions if there is no empty instruction
+  */
+uint16_t ProgramStore_GetEnd(void);
+
+
+/**
+  * @brief Returns the checksum of the program
+  * @details Changes with every edit, so an unchanged checksum means that a program doesn't have to be checked again.
+  */
+uint16_t ProgramStore_GetChecksum(void);
+
+
+/**
+  * @brief Reads an instruction
+  * @param position Position of the instruction (0 equals the first instruction)
+  * @return Read instruction (an empty instruction after the end of the program)
+  */
+Instruction ProgramStore_GetInstruction(uint16_t position);
+
+
+/**
+  * @brief Reads consecutive instructions with one read of each block they are stored in that is not in the window
+  * @param in Array receiving the instructions
+  * @param position Position of the first instruction
+  * @param count Number of instructions to be read
+  */
+void ProgramStore_GetInstructions(Instruction *in, uint16_t position, uint8_t count);
+
+
+/**
+  * @brief Starts reading the block holding a position into the window in the background (see EEPROM_StartReadBytes())
+  * @details The next function reading the block waits for the read to finish.
+  * @param position Position of the instruction
+  * @return true if the block is being read or already is in the window (false if the bus is busy, the window only
+  * holds changed blocks or the position is after the end of the program)
+  */
+bool ProgramStore_Prefetch(uint16_t position);
+
+
+/**
+  * @brief Overwrites the instruction at the given position
+  * @details Positions after the end of the program are filled up with empty instructions first. An instruction
+  * taking more bytes than the one it replaces may move instructions into another block (see ProgramStore_InsertInstruction()).
+  * @param in The instruction to be written
+  * @param position Position of the instruction
+  * @return false if the EEPROM is full
+  */
+bool ProgramStore_PutInstruction(Instruction in, uint16_t position);
+
+
+/**
+  * @brief Inserts an instruction, moving all following instructions down by one position
+  * @details Changes the block the instruction is inserted into. If it is full, its last instructions are moved into
+  * the next block if it has space for them, otherwise into a free page linked in behind the block.
+  * @param in The instruction to be inserted
+  * @param position Position of the new instruction (at most the number of stored instructions)
+  * @return false if the position is after the end of the program or the EEPROM is full
+  */
+bool ProgramStore_InsertInstruction(Instruction in, uint16_t position);
+
+
+/**
+  * @brief Deletes an instruction, moving all following instructions up by one position
+  * @details Changes the block the instruction is stored in, or unlinks the block if it was its only instruction.
+  * @param position Position of the instruction
+  */
+void ProgramStore_RemoveInstruction(uint16_t position);
+
+
+#endif
@@ -19,6 +19,12 @@ uint32_t buzzerFrequency = 0;
 //Documented in .h
 uint32_t lastWaitTick = 0;
 
+//Documented in .h
+volatile bool programmingMode = false;
+
+//Documented in .h
+volatile uint8_t buttonState = 0;
+
 
 /**
  * @brief Timer object used for the buzzer (provided by HAL)
@@ -32,14 +38,40 @@ extern ADC_HandleTypeDef hadc;
 
 
 //Documented in .h
-void STM_Wait(uint16_t pData)
+void STM_ReadModeSwitch(void)
+{
+	programmingMode = HAL_GPIO_ReadPin(ModeSwitch_GPIO_Port, ModeSwitch_Pin);
+}
+
+//Documented in .h
+uint32_t STM_GetMicros(void)
+{
+	uint32_t tick;
+	uint32_t count;
+	do
+	{
+		tick = HAL_GetTick();
+		count = SysTick->VAL;
+	} while(tick != HAL_GetTick());
+
+	return tick * 1000 + ((SysTick->LOAD - count) * 1000) / (SysTick->LOAD + 1);
+}
+
+//Documented in .h
+uint32_t STM_GetWaitEnd(uint16_t pData)
 {
 	if(lastWaitTick > HAL_GetTick()-100)
     	lastWaitTick = lastWaitTick+(pData*100);
 	else
 	 	lastWaitTick = HAL_GetTick()+(pData*100);
 
-    while(HAL_GetTick() < lastWaitTick && !isProgrammingMode());
+	return lastWaitTick;
+}
+
+//Documented in .h
+void STM_Sleep(void)
+{
+	__WFI();
 }
 
 //Documented in .h
@@ -170,25 +202,42 @@ int STM_ReadADC(uint8_t channel)
 
 
 //Documented in .h
-bool STM_IsInputHigh(uint8_t port)
+void STM_SampleButtons(void)
 {
-	HAL_Delay(10);
-	switch(port)
+	static uint8_t history[4] = {0, 0, 0, 0};
+
+	//All buttons are connected to the same port and pull their pin low when pressed
+	uint16_t idr = Button1_GPIO_Port->IDR;
+	const uint16_t pins[4] = {Button1_Pin, Button2_Pin, Button3_Pin, Button4_Pin};
+
+	for(uint8_t i = 0; i < 4; i++)
 	{
-		case 0:
-				return isButton1Pressed();
-				break;
-		case 1:
-				return isButton2Pressed();
-				break;
-		case 2:
-				return isButton3Pressed();
-				break;
-		case 3:
-				return isButton4Pressed();
-				break;
+		history[i] = (history[i] << 1) | ((idr & pins[i]) == 0);
+
+		if(history[i] == 0xFF && !(buttonState & (1 << i)))
+			buttonState |= (1 << i) | (1 << (i+4));
+		else if(history[i] == 0x00)
+			buttonState &= ~(1 << i);
 	}
-    return false;
+}
+
+//Documented in .h
+bool STM_IsInputHigh(uint8_t port)
+{
+	return (buttonState >> port) & 1;
+}
+
+//Documented in .h
+bool STM_TakeButtonPress(uint8_t port)
+{
+	uint8_t flag = 1 << (port+4);
+	if(!(buttonState & flag))
+		return false;
+
+	__disable_irq();
+	buttonState &= ~flag;
+	__enable_irq();
+	return true;
 }
 
 
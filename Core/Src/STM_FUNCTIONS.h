@@ -34,8 +34,24 @@
 
 /**
  * @brief Determines if the mode switch is set to programming mode
+ * @details Only reads a variable in RAM, so it can be checked before every instruction
  */
-#define isProgrammingMode() HAL_GPIO_ReadPin(ModeSwitch_GPIO_Port, ModeSwitch_Pin)
+#define isProgrammingMode() (programmingMode)
+
+
+/**
+ * @brief State of the mode switch (true = programming mode)
+ * @details Updated by STM_ReadModeSwitch() from the EXTI interrupt of the mode switch
+ */
+extern volatile bool programmingMode;
+
+
+/**
+ * @brief Debounced state of the buttons (updated by STM_SampleButtons())
+ * @details Bits 0-3: button 1-4 is pressed, bits 4-7: button 1-4 has been pressed since its flag was last taken
+ * (see STM_TakeButtonPress())
+ */
+extern volatile uint8_t buttonState;
 
 
 /**
@@ -46,10 +62,35 @@ extern uint32_t lastWaitTick;
 
 
 /**
-  * @brief Waits the given amount of time (in 1/10 seconds)
+  * @brief Reads the mode switch and stores its state in programmingMode
+  * @details Is called once at startup and everytime the mode switch triggers its EXTI interrupt
+  */
+void STM_ReadModeSwitch(void);
+
+
+/**
+  * @brief Returns the system time in us
+  * @details Combines the HAL tick with the current value of the SysTick counter. Rolls over every 71 minutes,
+  * which is fine for measuring durations.
+  */
+uint32_t STM_GetMicros(void);
+
+
+/**
+  * @brief Calculates the system tick at which a wait of the given time (in 1/10 seconds) ends
+  * @details If the last wait ended less than 100 ms ago, the time is counted from its end instead of from now.
+  * This compensates the runtime of the instructions between two waits, so e.g. blinking LEDs keep their frequency.
   * @param pData Delay time (in 1/10 seconds)
+  * @return System tick (in ms) at which the wait ends (also stored in lastWaitTick)
   */
-void STM_Wait(uint16_t pData);
+uint32_t STM_GetWaitEnd(uint16_t pData);
+
+
+/**
+  * @brief Puts the CPU to sleep until the next interrupt (WFI)
+  * @details SysTick wakes the CPU up at least once per millisecond.
+  */
+void STM_Sleep(void);
 
 
 /**
@@ -75,13 +116,29 @@ void STM_ActivateBuzzer(Instruction ex);
   */
 int STM_ReadADC(uint8_t channel);
 
+/**
+  * @brief Samples the buttons and updates their debounced state (buttonState)
+  * @details Is called by the SysTick interrupt every millisecond. A button changes its state once it has been read
+  * the same for 8 samples in a row. Pressing a button also sets its press flag.
+  */
+void STM_SampleButtons(void);
+
 /**
   * @brief Determines, if a certain input is high
+  * @details Only reads the debounced state (buttonState), so it returns immediately.
   * @param port The input to be processed: 0: Button 1, 1: Button 2, 2: Button 3, 3: Button 4
   * @return Bool that states if the input is high
   */
 bool STM_IsInputHigh(uint8_t port);
 
+/**
+  * @brief Determines, if a button has been pressed since the last call and clears its press flag
+  * @details A short press between two calls is not lost, several presses between two calls count as one.
+  * @param port The input to be processed: 0: Button 1, 1: Button 2, 2: Button 3, 3: Button 4
+  * @return Bool that states if the button has been pressed
+  */
+bool STM_TakeButtonPress(uint8_t port);
+
 /**
   * @brief Returns the chars corresponding to a number with 3 decimal places
   * @param pNum The number to be converted
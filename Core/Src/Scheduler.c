@@ -0,0 +1,158 @@
+/**
+ * @file Scheduler.c
+ * @brief Implementation of the scheduler
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "InstructionHandlers.h"
+#include "Scheduler.h"
+#include "STM_FUNCTIONS.h"
+#include "main.h"
+
+/**
+ * @brief States of a program context
+ */
+enum {
+	CONTEXT_FREE = 0,
+	CONTEXT_RUNNABLE,
+	CONTEXT_SUSPENDED
+};
+
+/**
+ * @brief All program contexts (the running one is only up to date after it has been stopped)
+ */
+static ProgramContext contexts[SCHEDULER_MAX_CONTEXTS];
+
+/**
+ * @brief Index of the running context
+ */
+static uint8_t current = 0;
+
+//Documented in .h
+bool contextSwitchPending = false;
+
+/**
+ * @brief Time (in us) the CPU slept
+ */
+static uint64_t sleepTime = 0;
+
+/**
+ * @brief Number of times the CPU was woken up while sleeping
+ */
+static uint32_t wakeups = 0;
+
+
+//Documented in .h
+void Scheduler_Init(void)
+{
+	for(uint8_t i = 0; i < SCHEDULER_MAX_CONTEXTS; i++)
+	{
+		contexts[i].state = CONTEXT_FREE;
+	}
+	current = 0;
+	InstructionHandlers_SaveContext(&contexts[0]);
+	contexts[0].state = CONTEXT_RUNNABLE;
+	contextSwitchPending = false;
+	sleepTime = 0;
+	wakeups = 0;
+}
+
+//Documented in .h
+bool Scheduler_Start(uint16_t position)
+{
+	for(uint8_t i = 0; i < SCHEDULER_MAX_CONTEXTS; i++)
+	{
+		if(contexts[i].state == CONTEXT_FREE)
+		{
+			contexts[i].programIndex = position;
+			contexts[i].regPointer = 0;
+			contexts[i].cursPos = 0;
+			contexts[i].lastWaitTick = HAL_GetTick();
+			contexts[i].state = CONTEXT_RUNNABLE;
+			return true;
+		}
+	}
+	return false;
+}
+
+//Documented in .h
+void Scheduler_Suspend(uint32_t pWakeTick)
+{
+	contexts[current].wakeTick = pWakeTick;
+	contexts[current].state = CONTEXT_SUSPENDED;
+	contextSwitchPending = true;
+}
+
+//Documented in .h
+void Scheduler_Yield(void)
+{
+	contextSwitchPending = true;
+}
+
+//Documented in .h
+void Scheduler_Exit(void)
+{
+	contexts[current].state = CONTEXT_FREE;
+	contextSwitchPending = true;
+}
+
+/**
+  * @brief Searches the next context that can run, starting after the running one
+  * @param alive Is set to false if all contexts are free
+  * @return Index of the context or SCHEDULER_MAX_CONTEXTS if none can run yet
+  */
+static uint8_t Scheduler_Find(bool *alive)
+{
+	uint32_t tick = HAL_GetTick();
+	*alive = false;
+	for(uint8_t k = 1; k <= SCHEDULER_MAX_CONTEXTS; k++)
+	{
+		uint8_t i = (current + k) % SCHEDULER_MAX_CONTEXTS;
+		if(contexts[i].state == CONTEXT_SUSPENDED && (int32_t)(tick - contexts[i].wakeTick) >= 0)
+			contexts[i].state = CONTEXT_RUNNABLE;
+
+		if(contexts[i].state == CONTEXT_RUNNABLE)
+			return i;
+		if(contexts[i].state != CONTEXT_FREE)
+			*alive = true;
+	}
+	return SCHEDULER_MAX_CONTEXTS;
+}
+
+//Documented in .h
+bool Scheduler_Next(void)
+{
+	contextSwitchPending = false;
+	if(contexts[current].state != CONTEXT_FREE)
+		InstructionHandlers_SaveContext(&contexts[current]);
+
+	bool alive;
+	uint8_t next;
+	while((next = Scheduler_Find(&alive)) == SCHEDULER_MAX_CONTEXTS)
+	{
+		if(!alive || isProgrammingMode())
+			return false;
+
+		uint32_t start = STM_GetMicros();
+		STM_Sleep();
+		sleepTime += STM_GetMicros() - start;
+		wakeups++;
+	}
+
+	current = next;
+	InstructionHandlers_LoadContext(&contexts[current]);
+	return true;
+}
+
+//Documented in .h
+uint32_t Scheduler_GetSleepTime(void)
+{
+	return sleepTime / 1000;
+}
+
+//Documented in .h
+uint32_t Scheduler_GetWakeups(void)
+{
+	return wakeups;
+}
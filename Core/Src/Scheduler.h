@@ -0,0 +1,125 @@
+/**
+ * @file Scheduler.h
+ * @brief Provides the scheduler which runs several program contexts and suspends them during WAI instead of busy waiting
+ * @details Every context has its own program index, register pointer, cursor and wait deadline, the registers are shared.
+ * The program starts in context 0, further contexts are started by the instruction THR.
+ * A context runs until it is suspended by WAI, yields (YLD) or reaches the end of the program. Then the next runnable
+ * context is chosen round-robin. If all contexts are suspended, the CPU sleeps (WFI) until the first wake tick is reached
+ * or the mode switch is operated. The CPU is woken up by every interrupt (at least by SysTick once per millisecond).
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Maximum number of program contexts running at the same time
+ */
+#define SCHEDULER_MAX_CONTEXTS 4
+
+/**
+ * @brief Struct to store the state of a program context while another context is running
+ */
+typedef struct {
+	/**
+	 * @brief Position of the next instruction
+	 */
+	uint16_t programIndex;
+
+	/**
+	 * @brief Register chosen by PIC
+	 */
+	uint8_t regPointer;
+
+	/**
+	 * @brief Position of the cursor for PCH and PTR
+	 */
+	uint8_t cursPos;
+
+	/**
+	 * @brief End of the last wait (see lastWaitTick)
+	 */
+	uint32_t lastWaitTick;
+
+	/**
+	 * @brief System tick at which a suspended context continues
+	 */
+	uint32_t wakeTick;
+
+	/**
+	 * @brief State of the context (free, runnable or suspended)
+	 */
+	uint8_t state;
+} ProgramContext;
+
+/**
+ * @brief Set when the running context has to stop after the current instruction (suspended, yielded)
+ */
+extern bool contextSwitchPending;
+
+/**
+ * @brief Determines if the running context has to stop after the current instruction
+ * @details Only reads a variable in RAM, so it can be checked before every instruction
+ */
+#define Scheduler_IsSwitchPending() (contextSwitchPending)
+
+
+/**
+  * @brief Makes the current program state context 0, frees all other contexts and resets the sleep statistics
+  * @warning Should be called everytime the program switches into executing mode, after InstructionHandlers_INIT()
+  */
+void Scheduler_Init(void);
+
+
+/**
+  * @brief Starts a new context at the given position
+  * @param position Position of the first instruction of the new context
+  * @return false if all contexts are in use (nothing is started)
+  */
+bool Scheduler_Start(uint16_t position);
+
+
+/**
+  * @brief Suspends the running context until the given system tick
+  * @details The context stops after the current instruction and continues once the tick is reached.
+  * @param pWakeTick System tick (in ms) at which the context continues
+  */
+void Scheduler_Suspend(uint32_t pWakeTick);
+
+
+/**
+  * @brief Stops the running context after the current instruction so the other contexts can run
+  */
+void Scheduler_Yield(void);
+
+
+/**
+  * @brief Ends the running context (e.g. because it reached the end of the program)
+  * @details The context doesn't execute any further instruction, InstructionList_Run() returns after the current one.
+  */
+void Scheduler_Exit(void);
+
+
+/**
+  * @brief Chooses the next context to be run (round-robin) and loads its state
+  * @details Sleeps until a suspended context can continue if no context is runnable.
+  * @return false if no context is left or the device has been switched into programming mode
+  */
+bool Scheduler_Next(void);
+
+
+/**
+  * @brief Returns the time (in ms) the CPU slept since the device was last switched into executing mode
+  */
+uint32_t Scheduler_GetSleepTime(void);
+
+
+/**
+  * @brief Returns the number of times the CPU was woken up by an interrupt while sleeping
+  * @details Divided by the sleep time this gives the interrupt load while all contexts are suspended.
+  */
+uint32_t Scheduler_GetWakeups(void);
+
+
+#endif
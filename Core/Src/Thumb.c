@@ -0,0 +1,39 @@
+/**
+ * @file Thumb.c
+ * @brief Implementation of the calls into the translated code on the Cortex-M0
+ */
+
+#include "InstructionHandlers.h"
+#include "ProgramFlash.h"
+#include "STM_FUNCTIONS.h"
+#include "Thumb.h"
+
+/**
+ * @brief Type of the prologue of the translated code
+ */
+typedef uint16_t (*Thumb_Prologue)(Thumb_State *state, uint32_t entry);
+
+//Documented in .h
+uint32_t Thumb_GetAddress(Thumb_Symbol_t symbol)
+{
+	switch(symbol)
+	{
+		case THUMB_CODE: return (uint32_t)ProgramFlash_GetRegion(PROGRAMFLASH_NATIVE);
+		case THUMB_REGISTERS: return (uint32_t)InstructionHandlers_GetRegisters();
+		case THUMB_MODE: return (uint32_t)&programmingMode;
+		case THUMB_ISINPUTHIGH: return (uint32_t)STM_IsInputHigh;
+		case THUMB_TAKEBUTTONPRESS: return (uint32_t)STM_TakeButtonPress;
+		case THUMB_READADC: return (uint32_t)STM_ReadADC;
+		case THUMB_SETLED: return (uint32_t)STM_SetLED;
+		default: return 0;
+	}
+}
+
+//Documented in .h
+uint16_t Thumb_Call(uint16_t prologue, uint16_t entry, Thumb_State *state)
+{
+	uint32_t code = (uint32_t)ProgramFlash_GetRegion(PROGRAMFLASH_NATIVE);
+
+	//The lowest bit keeps the CPU in the Thumb state
+	return ((Thumb_Prologue)(code + prologue + 1))(state, code + entry + 1);
+}
@@ -0,0 +1,67 @@
+/**
+ * @file Thumb.h
+ * @brief Calls the program translated into Thumb machine code (see NativeCode.h) and provides the addresses it uses
+ * @details The translated code is entered at its prologue with the address of a Thumb_State in r0 and the address of
+ * the first instruction to be executed in r1. While it runs, r4 holds the address of the registers, r5 twice the register
+ * pointer, r6 the address of the mode flag and r7 the number of executed instructions. The code returns the position
+ * of the next instruction that has to be executed by the handlers and writes r5 and r7 back into the state.
+ * The helpers are called with BL, so the code only calls functions following the AAPCS and keeps its state in registers
+ * saved by them.
+ *
+ * On the device the code is called like a C function in the NATIVE region of the flash. The host simulator executes it
+ * with an emulator of the Thumb instructions used by the translation (see Simulator/Src/SimThumb.c).
+ */
+
+#ifndef THUMB_H
+#define THUMB_H
+#include <stdint.h>
+
+/**
+ * @brief Defines the addresses used by the translated code
+ */
+typedef enum {
+	THUMB_CODE = 0,			///< Start of the flash region holding the translated code
+	THUMB_REGISTERS,		///< The 100 registers (see InstructionHandlers_GetRegisters())
+	THUMB_MODE,				///< The state of the mode switch (see isProgrammingMode())
+	THUMB_ISINPUTHIGH,		///< STM_IsInputHigh()
+	THUMB_TAKEBUTTONPRESS,	///< STM_TakeButtonPress()
+	THUMB_READADC,			///< STM_ReadADC()
+	THUMB_SETLED,			///< STM_SetLED()
+	Thumb_Symbol_t_MAX
+} Thumb_Symbol_t;
+
+/**
+ * @brief First symbol that is a function called by the translated code (all following symbols are functions as well)
+ */
+#define THUMB_FIRST_HELPER THUMB_ISINPUTHIGH
+
+/**
+ * @brief State passed to the translated code (the layout is used by its prologue and epilogue)
+ */
+typedef struct {
+	uint32_t registers;		///< Address of the registers
+	uint32_t mode;			///< Address of the mode flag
+	uint32_t regPointer;	///< Register chosen by PIC
+	uint32_t executed;		///< Number of executed instructions (increased by the code)
+} Thumb_State;
+
+
+/**
+  * @brief Returns the address of a symbol as seen by the translated code
+  * @details The address of a function has its lowest bit set like every Thumb function pointer.
+  * @param symbol The symbol
+  */
+uint32_t Thumb_GetAddress(Thumb_Symbol_t symbol);
+
+
+/**
+  * @brief Executes translated code until it returns
+  * @param prologue Offset of the prologue inside the NATIVE flash region
+  * @param entry Offset of the first instruction to be executed inside the NATIVE flash region
+  * @param state The state of the program (read by the prologue and written back by the epilogue)
+  * @return Position of the next instruction returned by the code
+  */
+uint16_t Thumb_Call(uint16_t prologue, uint16_t entry, Thumb_State *state);
+
+
+#endif
@@ -23,6 +23,7 @@
 /* USER CODE BEGIN Includes */
 long keyBuffer = 0;
 char framePos = 0;
+#include "Crc.h"
 #include "Display.h"
 #include "PS2Driver.h"
 #include "InstructionList.h"
@@ -50,6 +51,8 @@ char framePos = 0;
 ADC_HandleTypeDef hadc;
 
 I2C_HandleTypeDef hi2c1;
+DMA_HandleTypeDef hdma_i2c1_rx;
+DMA_HandleTypeDef hdma_i2c1_tx;
 
 TIM_HandleTypeDef htim14;
 
@@ -60,6 +63,7 @@ TIM_HandleTypeDef htim14;
 /* Private function prototypes -----------------------------------------------*/
 void SystemClock_Config(void);
 static void MX_GPIO_Init(void);
+static void MX_DMA_Init(void);
 static void MX_I2C1_Init(void);
 static void MX_ADC_Init(void);
 static void MX_TIM14_Init(void);
@@ -101,6 +105,7 @@ int main(void)
 
   /* Initialize all configured peripherals */
   MX_GPIO_Init();
+  MX_DMA_Init();
   MX_I2C1_Init();
   MX_ADC_Init();
   MX_TIM14_Init();
@@ -109,6 +114,7 @@ int main(void)
 	HAL_Delay(1);
   HAL_Delay(100);
   Display_Init();
+  Crc_Init();
   HAL_Delay(100);
   /* USER CODE END 2 */
 
@@ -359,6 +365,22 @@ static void MX_TIM14_Init(void)
 
 }
 
+/**
+  * Enable DMA controller clock
+  */
+static void MX_DMA_Init(void)
+{
+
+  /* DMA controller clock enable */
+  __HAL_RCC_DMA1_CLK_ENABLE();
+
+  /* DMA interrupt init */
+  /* DMA1_Channel2_3_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA1_Channel2_3_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Channel2_3_IRQn);
+
+}
+
 /**
   * @brief GPIO Initialization Function
   * @param None
@@ -388,7 +410,7 @@ static void MX_GPIO_Init(void)
 
   /*Configure GPIO pin : ModeSwitch_Pin */
   GPIO_InitStruct.Pin = ModeSwitch_Pin;
-  GPIO_InitStruct.Mode = GPIO_MODE_INPUT;
+  GPIO_InitStruct.Mode = GPIO_MODE_IT_RISING_FALLING;
   GPIO_InitStruct.Pull = GPIO_NOPULL;
   HAL_GPIO_Init(ModeSwitch_GPIO_Port, &GPIO_InitStruct);
 
@@ -433,7 +455,7 @@ static void MX_GPIO_Init(void)
   HAL_NVIC_EnableIRQ(EXTI4_15_IRQn);
 
   /* USER CODE BEGIN MX_GPIO_Init_2 */
-
+  STM_ReadModeSwitch();
   /* USER CODE END MX_GPIO_Init_2 */
 }
 
@@ -441,6 +463,12 @@ static void MX_GPIO_Init(void)
 
 void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
 {
+	if(GPIO_Pin == ModeSwitch_Pin)
+	{
+		STM_ReadModeSwitch();
+		return;
+	}
+
 	keyBuffer = (keyBuffer << 1) | HAL_GPIO_ReadPin (PS2DAT_GPIO_Port, PS2DAT_Pin);
 	framePos++;
 	if(framePos > 11)
@@ -0,0 +1,99 @@
+/**
+ * @file SimHAL.h
+ * @brief Provides the controls of the simulated hardware to the simulator
+ * @details The simulated time only advances when the firmware uses the hardware: I2C transfers take the time
+ * they would take on the bus, HAL_Delay() takes its full time and every HAL_GetTick() call takes 1 us.
+ * Scripted inputs are applied as soon as the simulated time passes their timestamp.
+ */
+
+#ifndef SIMHAL_H
+#define SIMHAL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "main.h"
+
+/**
+ * @brief Size of the simulated EEPROM in bytes
+ */
+#define SIMHAL_EEPROM_SIZE 0x1000
+
+/**
+ * @brief Memory of the simulated EEPROM
+ */
+extern uint8_t simEEPROM[SIMHAL_EEPROM_SIZE];
+
+/**
+ * @brief Number of flash pages erased in the regions holding the copy and the translation of the program (see SimProgramFlash.c)
+ */
+extern uint32_t simFlashErases;
+
+/**
+  * @brief Resets the simulated hardware: erased EEPROM, black display, no buttons pressed, time 0
+  */
+void SimHAL_Init(void);
+
+/**
+  * @brief Loads a script of timed inputs
+  * @details Every line has the format "<time in ms since the time origin> <command> <arguments>" with the commands
+  * "button <0-3> <0|1>", "adc <channel> <value>" and "mode <0|1>" (1 = programming mode). Lines starting with ';' are ignored.
+  * @param path Path of the script file
+  * @return false if the file could not be read or contains an invalid line
+  */
+bool SimHAL_LoadScript(const char *path);
+
+/**
+  * @brief Sets the time at which the simulated user switches the device back into programming mode
+  * @param ms Simulated time in ms (counted from the time origin)
+  */
+void SimHAL_SetTimeLimit(uint32_t ms);
+
+/**
+  * @brief Sets the time origin to the current simulated time
+  * @details The timestamps of the script and the time limit are counted from the time origin,
+  * which is usually the moment the device is switched into executing mode.
+  */
+void SimHAL_SetTimeOrigin(void);
+
+/**
+  * @brief Sets the position of the mode switch and triggers its interrupt
+  * @param programming true = programming mode, false = executing mode
+  */
+void SimHAL_SetModeSwitch(bool programming);
+
+/**
+  * @brief Returns the simulated time since SimHAL_Init() in us
+  */
+uint64_t SimHAL_GetTimeUs(void);
+
+/**
+  * @brief Returns a counter that increases with every access to the simulated hardware
+  * @details Used to detect the firmware waiting for an interrupt in a loop that only reads RAM.
+  */
+uint32_t SimHAL_GetActivity(void);
+
+/**
+  * @brief Writes the text shown on the display into two strings
+  * @details Every 8x16 pixel cell is compared to the font. Cells not showing a character are written as '?'.
+  * @param line1 Upper line (at least 17 chars)
+  * @param line2 Lower line (at least 17 chars)
+  */
+void SimHAL_GetDisplayText(char line1[17], char line2[17]);
+
+/**
+  * @brief Prints all pixels of the display to stdout
+  */
+void SimHAL_PrintDisplay(void);
+
+/**
+  * @brief Returns the colour letter of an LED as used by LD1/LD2 (or ' ' if it is off)
+  * @param led 0 = LD1, 1 = LD2
+  */
+char SimHAL_GetLEDColour(uint8_t led);
+
+/**
+  * @brief Returns if the buzzer timer is running
+  */
+bool SimHAL_IsBuzzerOn(void);
+
+#endif
@@ -0,0 +1,35 @@
+/**
+ * @file SimKeyboard.h
+ * @brief Provides a simulated keyboard which types a program in programming mode
+ */
+
+#ifndef SIMKEYBOARD_H
+#define SIMKEYBOARD_H
+#include <stdint.h>
+
+/**
+ * @brief Maximum number of keys that can be typed
+ */
+#define SIMKEYBOARD_MAX_KEYS 0x8000
+
+/**
+  * @brief Loads a program text which is typed in the next time the device is in programming mode
+  * @details Every line contains an instruction name and optionally its data, separated by spaces (e.g. "PIC R0").
+  * Empty lines and everything after ';' are ignored. A line holding only '#' or only the editing keys '^', '.', ','
+  * and ']' types these keys instead (see SimKeyboard.c).
+  * @param path Path of the program text
+  * @return Number of instructions in the text or -1 if the file could not be read or is too long
+  */
+int SimKeyboard_LoadProgram(const char *path);
+
+/**
+  * @brief Writes the loaded program text into an EEPROM image in the layout of older firmware instead of typing it
+  * @details The instructions are stored one after another from address 0, so ProgramStore_Load() converts them.
+  * Texts with other keys than instructions (e.g. '#') can't be written.
+  * @param eeprom The EEPROM image (must be erased)
+  * @param size Size of the image in bytes
+  * @return Number of written instructions or -1 if the text can't be written
+  */
+int SimKeyboard_WriteOldLayout(uint8_t *eeprom, uint16_t size);
+
+#endif
@@ -0,0 +1,188 @@
+/**
+ * @file main.h
+ * @brief Replaces Core/Inc/main.h when building the host simulator
+ * @details Declares the small part of the STM32 HAL used by the files in Core/Src. The functions are implemented
+ * by SimHAL.c, which emulates the EEPROM and the display on the I2C bus as well as the buttons, the ADC and the system time.
+ * This way the platform independent files as well as EEPROM.c, Display.c and STM_FUNCTIONS.c are compiled unchanged.
+ */
+
+#ifndef __MAIN_H
+#define __MAIN_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Status returned by the HAL functions
+ */
+typedef enum {
+	HAL_OK = 0,
+	HAL_ERROR,
+	HAL_BUSY,
+	HAL_TIMEOUT
+} HAL_StatusTypeDef;
+
+/**
+ * @brief State of a GPIO pin
+ */
+typedef enum {
+	GPIO_PIN_RESET = 0,
+	GPIO_PIN_SET
+} GPIO_PinState;
+
+/**
+ * @brief Registers of a GPIO port (only those used by the firmware)
+ */
+typedef struct {
+	uint32_t IDR;
+	uint32_t ODR;
+} GPIO_TypeDef;
+
+/**
+ * @brief State of the I2C peripheral (only those used by the firmware)
+ */
+typedef enum {
+	HAL_I2C_STATE_READY = 0x20U,
+	HAL_I2C_STATE_BUSY_TX = 0x21U,
+	HAL_I2C_STATE_BUSY_RX = 0x22U
+} HAL_I2C_StateTypeDef;
+
+/**
+ * @brief I2C handle (the simulated bus has no configuration)
+ */
+typedef struct {
+	uint32_t ErrorCode;
+} I2C_HandleTypeDef;
+
+/**
+ * @brief ADC handle (the simulated ADC has no configuration)
+ */
+typedef struct {
+	uint32_t ErrorCode;
+} ADC_HandleTypeDef;
+
+/**
+ * @brief Timer configuration (only those fields used by the firmware)
+ */
+typedef struct {
+	uint32_t Prescaler;
+	uint32_t Period;
+} TIM_Base_InitTypeDef;
+
+/**
+ * @brief Timer handle
+ */
+typedef struct {
+	TIM_Base_InitTypeDef Init;
+	bool running;
+} TIM_HandleTypeDef;
+
+/**
+ * @brief Registers of the SysTick timer (only those used by the firmware)
+ */
+typedef struct {
+	uint32_t LOAD;
+	uint32_t VAL;
+} SysTick_Type;
+
+/**
+ * @brief Returns the SysTick registers matching the current simulated time
+ */
+SysTick_Type* SimHAL_GetSysTick(void);
+
+#define SysTick (SimHAL_GetSysTick())
+
+/**
+ * @brief Lets the simulated time pass until the next interrupt (the next SysTick)
+ */
+void SimHAL_WaitForInterrupt(void);
+
+#define __WFI() SimHAL_WaitForInterrupt()
+
+//The simulated interrupts are called synchronously, so they never have to be disabled
+#define __disable_irq()
+#define __enable_irq()
+
+extern GPIO_TypeDef simGPIOA;
+extern GPIO_TypeDef simGPIOB;
+extern GPIO_TypeDef simGPIOC;
+
+#define GPIOA (&simGPIOA)
+#define GPIOB (&simGPIOB)
+#define GPIOC (&simGPIOC)
+
+#define GPIO_PIN_0  ((uint16_t)0x0001)
+#define GPIO_PIN_1  ((uint16_t)0x0002)
+#define GPIO_PIN_2  ((uint16_t)0x0004)
+#define GPIO_PIN_3  ((uint16_t)0x0008)
+#define GPIO_PIN_4  ((uint16_t)0x0010)
+#define GPIO_PIN_5  ((uint16_t)0x0020)
+#define GPIO_PIN_6  ((uint16_t)0x0040)
+#define GPIO_PIN_7  ((uint16_t)0x0080)
+#define GPIO_PIN_8  ((uint16_t)0x0100)
+#define GPIO_PIN_9  ((uint16_t)0x0200)
+#define GPIO_PIN_10 ((uint16_t)0x0400)
+#define GPIO_PIN_11 ((uint16_t)0x0800)
+#define GPIO_PIN_12 ((uint16_t)0x1000)
+#define GPIO_PIN_13 ((uint16_t)0x2000)
+#define GPIO_PIN_14 ((uint16_t)0x4000)
+#define GPIO_PIN_15 ((uint16_t)0x8000)
+
+#define HAL_MAX_DELAY 0xFFFFFFFFU
+#define I2C_MEMADD_SIZE_8BIT 0x00000001U
+#define I2C_MEMADD_SIZE_16BIT 0x00000002U
+
+#define __HAL_TIM_SET_AUTORELOAD(__HANDLE__, __AUTORELOAD__) ((__HANDLE__)->Init.Period = (__AUTORELOAD__))
+#define __HAL_TIM_SET_COUNTER(__HANDLE__, __COUNTER__) ((void)(__HANDLE__), (void)(__COUNTER__))
+
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t Delay);
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Read_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size);
+HAL_I2C_StateTypeDef HAL_I2C_GetState(I2C_HandleTypeDef *hi2c);
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Write_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size);
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c);
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_IsDeviceReady(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint32_t Trials, uint32_t Timeout);
+HAL_StatusTypeDef HAL_ADC_Start(ADC_HandleTypeDef *hadc);
+HAL_StatusTypeDef HAL_ADC_PollForConversion(ADC_HandleTypeDef *hadc, uint32_t Timeout);
+uint32_t HAL_ADC_GetValue(ADC_HandleTypeDef *hadc);
+HAL_StatusTypeDef HAL_TIM_Base_Start(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_Base_Stop(TIM_HandleTypeDef *htim);
+uint32_t HAL_RCC_GetPCLK1Freq(void);
+void Error_Handler(void);
+
+#define ModeSwitch_Pin GPIO_PIN_13
+#define ModeSwitch_GPIO_Port GPIOC
+#define Summer_Pin GPIO_PIN_7
+#define Summer_GPIO_Port GPIOA
+#define Button4_Pin GPIO_PIN_12
+#define Button4_GPIO_Port GPIOB
+#define Button3_Pin GPIO_PIN_13
+#define Button3_GPIO_Port GPIOB
+#define Button2_Pin GPIO_PIN_14
+#define Button2_GPIO_Port GPIOB
+#define Button1_Pin GPIO_PIN_15
+#define Button1_GPIO_Port GPIOB
+#define PS2CLK_Pin GPIO_PIN_11
+#define PS2CLK_GPIO_Port GPIOA
+#define PS2DAT_Pin GPIO_PIN_12
+#define PS2DAT_GPIO_Port GPIOA
+#define LED2B_Pin GPIO_PIN_4
+#define LED2B_GPIO_Port GPIOB
+#define LED2G_Pin GPIO_PIN_5
+#define LED2G_GPIO_Port GPIOB
+#define LED2R_Pin GPIO_PIN_6
+#define LED2R_GPIO_Port GPIOB
+#define LED1B_Pin GPIO_PIN_7
+#define LED1B_GPIO_Port GPIOB
+#define LED1G_Pin GPIO_PIN_8
+#define LED1G_GPIO_Port GPIOB
+#define LED1R_Pin GPIO_PIN_9
+#define LED1R_GPIO_Port GPIOB
+
+#endif /* __MAIN_H */
@@ -0,0 +1,48 @@
+/**
+ * @file SimCrc.c
+ * @brief Replaces Crc.c when building the host simulator
+ * @details Calculates the checksums bit by bit in software, giving the same values as the CRC unit of the STM32F0.
+ */
+
+#include "Crc.h"
+
+/**
+ * @brief Polynomial of the CRC unit
+ */
+#define SIMCRC_POLYNOMIAL 0x04C11DB7
+
+/**
+ * @brief Current value of the checksum
+ */
+static uint32_t crc = 0xFFFFFFFF;
+
+//Documented in Crc.h
+void Crc_Init(void)
+{
+}
+
+//Documented in Crc.h
+void Crc_Start(void)
+{
+	crc = 0xFFFFFFFF;
+}
+
+//Documented in Crc.h
+void Crc_Add(const uint8_t *data, uint16_t size)
+{
+	for(uint16_t i = 0; i < size; i++)
+	{
+		//The most significant bit is processed first
+		crc ^= (uint32_t)data[i] << 24;
+		for(uint8_t bit = 0; bit < 8; bit++)
+		{
+			crc = (crc & 0x80000000) ? (crc << 1) ^ SIMCRC_POLYNOMIAL : crc << 1;
+		}
+	}
+}
+
+//Documented in Crc.h
+uint32_t Crc_Get(void)
+{
+	return crc;
+}
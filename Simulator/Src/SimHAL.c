@@ -0,0 +1,694 @@
+/**
+ * @file SimHAL.c
+ * @brief Implementation of the HAL functions used by the firmware on top of simulated hardware
+ * @details The I2C bus is connected to a simulated 24C32 EEPROM (address 0x50) and a simulated
+ * SSD1306 display (address 0x3C). Buttons, the ADC and the mode switch are controlled by the simulator.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "main.h"
+#include "SimHAL.h"
+#include "STM_FUNCTIONS.h"
+
+/**
+ * @brief Font used by Display.c (defined in Font.h)
+ */
+extern const uint8_t display_font[];
+
+/**
+ * @brief Time one byte takes on the I2C bus in us (9 bits at 400 kHz)
+ */
+#define SIMHAL_I2C_BYTE_US 23
+
+/**
+ * @brief Time the EEPROM is busy after a write in us
+ */
+#define SIMHAL_EEPROM_WRITE_US 5000
+
+/**
+ * @brief Size of an EEPROM page in bytes (a write wraps around inside its page)
+ */
+#define SIMHAL_EEPROM_PAGE_SIZE 32
+
+/**
+ * @brief Maximum number of lines in a script
+ */
+#define SIMHAL_MAX_EVENTS 256
+
+/**
+ * @brief Struct to store one scripted input
+ */
+typedef struct {
+	uint32_t timeMs;
+	char command;
+	uint8_t argument;
+	uint16_t value;
+} SimEvent;
+
+GPIO_TypeDef simGPIOA;
+GPIO_TypeDef simGPIOB;
+GPIO_TypeDef simGPIOC;
+
+I2C_HandleTypeDef hi2c1;
+ADC_HandleTypeDef hadc;
+TIM_HandleTypeDef htim14;
+
+//Documented in .h
+uint8_t simEEPROM[SIMHAL_EEPROM_SIZE];
+
+/**
+ * @brief Simulated time in us
+ */
+static uint64_t simTimeUs;
+
+/**
+ * @brief Simulated time in us from which the script and the time limit are counted (UINT64_MAX = not set yet)
+ */
+static uint64_t timeOriginUs;
+
+/**
+ * @brief Time in us (counted from timeOriginUs) at which the mode switch is set to programming mode
+ */
+static uint64_t timeLimitUs = UINT64_MAX;
+
+/**
+ * @brief Simulated time in us until which the EEPROM does not acknowledge (write cycle)
+ */
+static uint64_t eepromBusyUntilUs;
+
+/**
+ * @brief Simulated time in us until which the bus is used by a DMA transfer
+ */
+static uint64_t dmaBusyUntilUs;
+
+/**
+ * @brief Transfer started with DMA, which is carried out and calls the completion callback once dmaBusyUntilUs has
+ * passed (size = 0 if there is none)
+ */
+static struct {
+	bool read;
+	uint16_t devAddress;
+	uint16_t memAddress;
+	uint8_t *data;
+	uint16_t size;
+} dmaTransfer;
+
+/**
+ * @brief Counter of hardware accesses
+ */
+static volatile uint32_t activity;
+
+/**
+ * @brief Scripted inputs sorted by time
+ */
+static SimEvent events[SIMHAL_MAX_EVENTS];
+
+/**
+ * @brief Number of scripted inputs
+ */
+static uint16_t eventCount;
+
+/**
+ * @brief Next scripted input to be applied
+ */
+static uint16_t nextEvent;
+
+/**
+ * @brief Position of the simulated mode switch (true = programming mode)
+ */
+static volatile bool modeSwitch;
+
+/**
+ * @brief Pins of the buttons 1-4
+ */
+static const uint16_t buttonPins[4] = {Button1_Pin, Button2_Pin, Button3_Pin, Button4_Pin};
+
+/**
+ * @brief Values of the ADC channels
+ */
+static uint8_t adcValues[9];
+
+/**
+ * @brief Channel converted by the next ADC conversion (the channels are converted one after another)
+ */
+static uint8_t adcChannel;
+
+/**
+ * @brief Value of the last ADC conversion
+ */
+static uint8_t adcResult;
+
+/**
+ * @brief Memory of the simulated display (4 pages of 128 columns)
+ */
+static uint8_t displayRAM[4][128];
+
+/**
+ * @brief State of the simulated display's address pointer and command parser
+ */
+static struct {
+	uint8_t column;
+	uint8_t page;
+	uint8_t columnStart;
+	uint8_t columnEnd;
+	uint8_t pageStart;
+	uint8_t pageEnd;
+	uint8_t command;
+	uint8_t argumentsLeft;
+	uint8_t arguments[2];
+} display;
+
+
+/**
+  * @brief Sets the level of a button's pin (the buttons pull their pin low when pressed)
+  * @param button 0-3 = button 1-4
+  * @param pressed true if the button is pressed
+  */
+static void SimHAL_SetButton(uint8_t button, bool pressed)
+{
+	if(pressed)
+		simGPIOB.IDR &= ~buttonPins[button];
+	else
+		simGPIOB.IDR |= buttonPins[button];
+}
+
+/**
+  * @brief Applies the scripted inputs and the time limit reached by the simulated time
+  */
+static void SimHAL_ApplyEvents(void)
+{
+	if(simTimeUs < timeOriginUs)
+		return;
+
+	while(nextEvent < eventCount && (uint64_t)events[nextEvent].timeMs * 1000 <= simTimeUs - timeOriginUs)
+	{
+		SimEvent *e = &events[nextEvent++];
+		if(e->command == 'b')
+			SimHAL_SetButton(e->argument, e->value);
+		else if(e->command == 'a')
+			adcValues[e->argument] = e->value;
+		else if(e->command == 'm')
+			SimHAL_SetModeSwitch(e->value);
+	}
+
+	if(simTimeUs - timeOriginUs >= timeLimitUs && !modeSwitch)
+		SimHAL_SetModeSwitch(true);
+}
+
+/**
+  * @brief Executes a command byte (or argument byte) sent to the display
+  * @param byte The byte received
+  */
+static void SimHAL_DisplayCommand(uint8_t byte)
+{
+	if(display.argumentsLeft > 0)
+	{
+		display.arguments[display.command == 0x21 || display.command == 0x22 ? 2 - display.argumentsLeft : 0] = byte;
+		if(--display.argumentsLeft > 0)
+			return;
+
+		if(display.command == 0x21)
+		{
+			display.columnStart = display.arguments[0] & 0x7F;
+			display.columnEnd = display.arguments[1] & 0x7F;
+			display.column = display.columnStart;
+		}
+		else if(display.command == 0x22)
+		{
+			display.pageStart = display.arguments[0] & 0x03;
+			display.pageEnd = display.arguments[1] & 0x03;
+			display.page = display.pageStart;
+		}
+		return;
+	}
+
+	display.command = byte;
+	if(byte == 0x21 || byte == 0x22)
+		display.argumentsLeft = 2;
+	else if(byte == 0x20 || byte == 0x81 || byte == 0xA8 || byte == 0xD3 || byte == 0xD5
+			|| byte == 0xD9 || byte == 0xDA || byte == 0xDB || byte == 0x8D)
+		display.argumentsLeft = 1;
+	else if((byte & 0xF8) == 0xB0)
+		display.page = byte & 0x03;
+	else if(byte <= 0x0F)
+		display.column = (display.column & 0xF0) | byte;
+	else if(byte <= 0x1F)
+		display.column = (display.column & 0x0F) | ((byte & 0x07) << 4);
+}
+
+/**
+  * @brief Writes a byte into the display memory and advances the address pointer (horizontal addressing)
+  * @param byte The byte received
+  */
+static void SimHAL_DisplayData(uint8_t byte)
+{
+	displayRAM[display.page & 0x03][display.column & 0x7F] = byte;
+	if(display.column++ >= display.columnEnd)
+	{
+		display.column = display.columnStart;
+		display.page = (display.page >= display.pageEnd) ? display.pageStart : display.page + 1;
+	}
+}
+
+/**
+  * @brief Passes the bytes following a control byte to the display
+  * @param control The control byte (0x40 for data, otherwise commands)
+  * @param data The bytes following the control byte
+  * @param size Number of bytes
+  */
+static void SimHAL_DisplayReceive(uint8_t control, const uint8_t *data, uint16_t size)
+{
+	for(uint16_t i = 0; i < size; i++)
+	{
+		if(control & 0x40)
+			SimHAL_DisplayData(data[i]);
+		else
+			SimHAL_DisplayCommand(data[i]);
+	}
+}
+
+/**
+  * @brief Reads bytes from the simulated EEPROM (sequential read wrapping around at the end of the memory)
+  * @param address Address of the first byte
+  * @param data Buffer for the bytes
+  * @param size Number of bytes
+  */
+static void SimHAL_ReadEEPROM(uint16_t address, uint8_t *data, uint16_t size)
+{
+	for(uint16_t i = 0; i < size; i++)
+	{
+		data[i] = simEEPROM[(address + i) % SIMHAL_EEPROM_SIZE];
+	}
+}
+
+/**
+  * @brief Writes bytes into the simulated EEPROM (wrapping around at the end of the page) and starts its write cycle
+  * @param address Address of the first byte
+  * @param data The bytes
+  * @param size Number of bytes
+  */
+static void SimHAL_WriteEEPROM(uint16_t address, const uint8_t *data, uint16_t size)
+{
+	uint16_t pageStart = (address % SIMHAL_EEPROM_SIZE) & ~(SIMHAL_EEPROM_PAGE_SIZE - 1);
+	for(uint16_t i = 0; i < size; i++)
+	{
+		simEEPROM[pageStart + (address + i) % SIMHAL_EEPROM_PAGE_SIZE] = data[i];
+	}
+	eepromBusyUntilUs = simTimeUs + SIMHAL_EEPROM_WRITE_US;
+}
+
+/**
+  * @brief Advances the simulated time and applies everything that happens until then
+  * @param us Time in us
+  */
+static void SimHAL_Advance(uint32_t us)
+{
+	uint64_t ticks = (simTimeUs + us) / 1000 - simTimeUs / 1000;
+	simTimeUs += us;
+	activity++;
+
+	SimHAL_ApplyEvents();
+
+	//Call the SysTick interrupt for every millisecond that has passed
+	for(; ticks > 0; ticks--)
+	{
+		STM_SampleButtons();
+	}
+
+	//The interrupt at the end of a transfer with DMA
+	if(dmaTransfer.size > 0 && simTimeUs >= dmaBusyUntilUs)
+	{
+		uint16_t size = dmaTransfer.size;
+		dmaTransfer.size = 0;
+		if(dmaTransfer.read)
+		{
+			SimHAL_ReadEEPROM(dmaTransfer.memAddress, dmaTransfer.data, size);
+			HAL_I2C_MemRxCpltCallback(&hi2c1);
+		}
+		else
+		{
+			if(dmaTransfer.devAddress == (0x3C << 1))
+				SimHAL_DisplayReceive(dmaTransfer.memAddress, dmaTransfer.data, size);
+			else
+				SimHAL_WriteEEPROM(dmaTransfer.memAddress, dmaTransfer.data, size);
+			HAL_I2C_MemTxCpltCallback(&hi2c1);
+		}
+	}
+}
+
+//Documented in .h
+void SimHAL_Init(void)
+{
+	memset(simEEPROM, 0, sizeof(simEEPROM));
+	memset(displayRAM, 0, sizeof(displayRAM));
+	memset(&display, 0, sizeof(display));
+	display.columnEnd = 127;
+	display.pageEnd = 3;
+	memset(adcValues, 0, sizeof(adcValues));
+	adcChannel = 0;
+	simGPIOA.ODR = 0;
+	simGPIOB.ODR = 0xFFFF;
+	simGPIOB.IDR = Button1_Pin | Button2_Pin | Button3_Pin | Button4_Pin;
+	simGPIOC.ODR = 0;
+	simTimeUs = 0;
+	timeOriginUs = UINT64_MAX;
+	eepromBusyUntilUs = 0;
+	dmaBusyUntilUs = 0;
+	dmaTransfer.size = 0;
+	eventCount = 0;
+	nextEvent = 0;
+	modeSwitch = true;
+}
+
+/**
+  * @brief Compares two scripted inputs by their time
+  */
+static int SimHAL_CompareEvents(const void *a, const void *b)
+{
+	const SimEvent *ea = a;
+	const SimEvent *eb = b;
+	return (ea->timeMs > eb->timeMs) - (ea->timeMs < eb->timeMs);
+}
+
+//Documented in .h
+bool SimHAL_LoadScript(const char *path)
+{
+	FILE *f = fopen(path, "r");
+	if(f == NULL)
+		return false;
+
+	char line[128];
+	bool ok = true;
+	while(fgets(line, sizeof(line), f) != NULL)
+	{
+		unsigned timeMs, argument, value;
+		char command[16];
+		if(line[0] == ';' || line[0] == '\n' || line[0] == '\r')
+			continue;
+		if(eventCount >= SIMHAL_MAX_EVENTS)
+		{
+			ok = false;
+			break;
+		}
+
+		SimEvent *e = &events[eventCount];
+		if(sscanf(line, "%u %15s %u %u", &timeMs, command, &argument, &value) == 4 && strcmp(command, "button") == 0 && argument < 4)
+			*e = (SimEvent){timeMs, 'b', argument, value != 0};
+		else if(sscanf(line, "%u %15s %u %u", &timeMs, command, &argument, &value) == 4 && strcmp(command, "adc") == 0 && argument < 9)
+			*e = (SimEvent){timeMs, 'a', argument, value};
+		else if(sscanf(line, "%u %15s %u", &timeMs, command, &value) == 3 && strcmp(command, "mode") == 0)
+			*e = (SimEvent){timeMs, 'm', 0, value != 0};
+		else
+		{
+			fprintf(stderr, "Invalid script line: %s", line);
+			ok = false;
+			break;
+		}
+		eventCount++;
+	}
+	fclose(f);
+
+	qsort(events, eventCount, sizeof(SimEvent), SimHAL_CompareEvents);
+	return ok;
+}
+
+//Documented in .h
+void SimHAL_SetTimeLimit(uint32_t ms)
+{
+	timeLimitUs = (uint64_t)ms * 1000;
+}
+
+//Documented in .h
+void SimHAL_SetTimeOrigin(void)
+{
+	timeOriginUs = simTimeUs;
+}
+
+//Documented in .h
+void SimHAL_SetModeSwitch(bool programming)
+{
+	modeSwitch = programming;
+	STM_ReadModeSwitch();
+}
+
+//Documented in .h
+uint64_t SimHAL_GetTimeUs(void)
+{
+	return simTimeUs;
+}
+
+//Documented in .h
+uint32_t SimHAL_GetActivity(void)
+{
+	return activity;
+}
+
+uint32_t HAL_GetTick(void)
+{
+	SimHAL_Advance(1);
+	return simTimeUs / 1000;
+}
+
+SysTick_Type* SimHAL_GetSysTick(void)
+{
+	//SysTick counts down from LOAD once every ms (8 MHz clock)
+	static SysTick_Type sysTick = {.LOAD = 7999};
+	sysTick.VAL = sysTick.LOAD - (simTimeUs % 1000) * 8;
+	return &sysTick;
+}
+
+void SimHAL_WaitForInterrupt(void)
+{
+	SimHAL_Advance(1000 - simTimeUs % 1000);
+}
+
+void HAL_Delay(uint32_t Delay)
+{
+	SimHAL_Advance(Delay * 1000);
+}
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+	activity++;
+	if(GPIOx == ModeSwitch_GPIO_Port && GPIO_Pin == ModeSwitch_Pin)
+		return modeSwitch ? GPIO_PIN_SET : GPIO_PIN_RESET;
+
+	if(GPIOx == GPIOB && (GPIO_Pin & (Button1_Pin | Button2_Pin | Button3_Pin | Button4_Pin)))
+		return (GPIOx->IDR & GPIO_Pin) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+	return (GPIOx->ODR & GPIO_Pin) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+	activity++;
+	if(PinState == GPIO_PIN_SET)
+		GPIOx->ODR |= GPIO_Pin;
+	else
+		GPIOx->ODR &= ~GPIO_Pin;
+}
+
+/**
+  * @brief Lets the simulated time pass that a transfer takes on the I2C bus
+  * @param bytes Number of bytes including the address byte(s)
+  */
+static void SimHAL_I2CTransfer(uint32_t bytes)
+{
+	SimHAL_Advance(bytes * SIMHAL_I2C_BYTE_US);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+	if(simTimeUs < dmaBusyUntilUs)
+		return HAL_BUSY;
+
+	SimHAL_I2CTransfer(2 + MemAddSize + Size);
+	if(DevAddress != (0x50 << 1) || simTimeUs < eepromBusyUntilUs)
+		return HAL_ERROR;
+
+	SimHAL_ReadEEPROM(MemAddress, pData, Size);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size)
+{
+	activity++;
+	if(simTimeUs < dmaBusyUntilUs)
+		return HAL_BUSY;
+	if(DevAddress != (0x50 << 1) || simTimeUs < eepromBusyUntilUs || Size == 0)
+		return HAL_ERROR;
+
+	//The data arrives when the transfer has finished
+	dmaTransfer.read = true;
+	dmaTransfer.devAddress = DevAddress;
+	dmaTransfer.memAddress = MemAddress;
+	dmaTransfer.data = pData;
+	dmaTransfer.size = Size;
+	dmaBusyUntilUs = simTimeUs + (2 + MemAddSize + Size) * SIMHAL_I2C_BYTE_US;
+	return HAL_OK;
+}
+
+HAL_I2C_StateTypeDef HAL_I2C_GetState(I2C_HandleTypeDef *hi2c)
+{
+	//Reading the state takes time, so a loop polling it lets the transfer finish
+	SimHAL_Advance(1);
+	if(simTimeUs >= dmaBusyUntilUs)
+		return HAL_I2C_STATE_READY;
+	return dmaTransfer.read ? HAL_I2C_STATE_BUSY_RX : HAL_I2C_STATE_BUSY_TX;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size)
+{
+	activity++;
+	if(simTimeUs < dmaBusyUntilUs)
+		return HAL_BUSY;
+	bool display = DevAddress == (0x3C << 1) && MemAddSize == I2C_MEMADD_SIZE_8BIT;
+	bool eeprom = DevAddress == (0x50 << 1) && MemAddSize == I2C_MEMADD_SIZE_16BIT && simTimeUs >= eepromBusyUntilUs;
+	if(!(display || eeprom) || Size == 0)
+		return HAL_ERROR;
+
+	//The device receives the data when the transfer has finished, so the data must not change until then
+	dmaTransfer.read = false;
+	dmaTransfer.devAddress = DevAddress;
+	dmaTransfer.memAddress = MemAddress;
+	dmaTransfer.data = pData;
+	dmaTransfer.size = Size;
+	dmaBusyUntilUs = simTimeUs + (1 + MemAddSize + Size) * SIMHAL_I2C_BYTE_US;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_IsDeviceReady(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint32_t Trials, uint32_t Timeout)
+{
+	if(simTimeUs < dmaBusyUntilUs)
+		return HAL_BUSY;
+
+	SimHAL_I2CTransfer(1);
+	if(DevAddress == (0x50 << 1))
+		return simTimeUs < eepromBusyUntilUs ? HAL_BUSY : HAL_OK;
+	return DevAddress == (0x3C << 1) ? HAL_OK : HAL_ERROR;
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+	if(simTimeUs < dmaBusyUntilUs)
+		return HAL_BUSY;
+
+	SimHAL_I2CTransfer(1 + Size);
+	if(DevAddress != (0x3C << 1) || Size == 0)
+		return HAL_ERROR;
+
+	SimHAL_DisplayReceive(pData[0], &pData[1], Size - 1);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+	if(simTimeUs < dmaBusyUntilUs)
+		return HAL_BUSY;
+
+	SimHAL_I2CTransfer(1 + MemAddSize + Size);
+
+	//The control byte of the display is sent like an 8 bit memory address
+	if(DevAddress == (0x3C << 1) && MemAddSize == I2C_MEMADD_SIZE_8BIT)
+	{
+		SimHAL_DisplayReceive(MemAddress, pData, Size);
+		return HAL_OK;
+	}
+	if(DevAddress != (0x50 << 1) || simTimeUs < eepromBusyUntilUs)
+		return HAL_ERROR;
+
+	SimHAL_WriteEEPROM(MemAddress, pData, Size);
+	return HAL_OK;
+}
+
+
+HAL_StatusTypeDef HAL_ADC_Start(ADC_HandleTypeDef *hadc)
+{
+	activity++;
+	adcResult = adcValues[adcChannel];
+	adcChannel = (adcChannel + 1) % 9;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADC_PollForConversion(ADC_HandleTypeDef *hadc, uint32_t Timeout)
+{
+	SimHAL_Advance(2);
+	return HAL_OK;
+}
+
+uint32_t HAL_ADC_GetValue(ADC_HandleTypeDef *hadc)
+{
+	return adcResult;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Start(TIM_HandleTypeDef *htim)
+{
+	htim->running = true;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Stop(TIM_HandleTypeDef *htim)
+{
+	htim->running = false;
+	return HAL_OK;
+}
+
+uint32_t HAL_RCC_GetPCLK1Freq(void)
+{
+	return 8000000;
+}
+
+void Error_Handler(void)
+{
+	fprintf(stderr, "Error_Handler called\n");
+	exit(1);
+}
+
+//Documented in .h
+void SimHAL_GetDisplayText(char line1[17], char line2[17])
+{
+	char *lines[2] = {line1, line2};
+	for(uint8_t row = 0; row < 2; row++)
+	{
+		for(uint8_t cell = 0; cell < 16; cell++)
+		{
+			const uint8_t *top = &displayRAM[row*2][cell*8];
+			const uint8_t *bottom = &displayRAM[row*2+1][cell*8];
+			char found = '?';
+			for(int ch = 32; ch < 127 && found == '?'; ch++)
+			{
+				if(memcmp(top, &display_font[(ch-32)*8], 8) == 0 && memcmp(bottom, &display_font[(ch+63)*8], 8) == 0)
+					found = ch;
+			}
+			lines[row][cell] = found;
+		}
+		lines[row][16] = 0;
+	}
+}
+
+//Documented in .h
+void SimHAL_PrintDisplay(void)
+{
+	for(uint8_t y = 0; y < 32; y++)
+	{
+		for(uint8_t x = 0; x < 128; x++)
+		{
+			putchar((displayRAM[y/8][x] >> (y%8)) & 1 ? '#' : '.');
+		}
+		putchar('\n');
+	}
+}
+
+//Documented in .h
+char SimHAL_GetLEDColour(uint8_t led)
+{
+	static const char colours[8] = {'W', 'O', 'V', 'R', 'T', 'G', 'B', ' '};
+	return colours[(simGPIOB.ODR >> (led == 0 ? 7 : 4)) & 0b111];
+}
+
+//Documented in .h
+bool SimHAL_IsBuzzerOn(void)
+{
+	return htim14.running;
+}
@@ -0,0 +1,148 @@
+/**
+ * @file SimKeyboard.c
+ * @brief Replaces PS2Driver.c when building the host simulator
+ * @details Instead of decoding PS/2 frames, PS2_GetKey() "types" a program text loaded by SimKeyboard_LoadProgram().
+ * Every line of the text is typed as the instruction name, a space and the data characters followed by Enter (']').
+ * A line holding only '#' presses F2 instead, so the following lines are typed into the next program slot.
+ * A line holding only the editing keys '^' (up), '.' (insert), ',' (delete) and ']' (Enter) types them as they are.
+ * Once all keys have been typed the mode switch is set to executing mode.
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+#include "InstructionHandlers.h"
+#include "PS2Driver.h"
+#include "SimHAL.h"
+#include "SimKeyboard.h"
+
+//Documented in PS2Driver.h
+long keyBuffer = 0;
+
+//Documented in PS2Driver.h
+char framePos = 0;
+
+/**
+ * @brief Keys to be typed
+ */
+static char keys[SIMKEYBOARD_MAX_KEYS];
+
+/**
+ * @brief Number of keys to be typed
+ */
+static uint16_t keyCount = 0;
+
+/**
+ * @brief Next key to be typed
+ */
+static uint16_t nextKey = 0;
+
+
+//Documented in .h
+int SimKeyboard_LoadProgram(const char *path)
+{
+	FILE *f = fopen(path, "r");
+	if(f == NULL)
+		return -1;
+
+	char line[128];
+	int instructions = 0;
+	keyCount = 0;
+	nextKey = 0;
+	while(fgets(line, sizeof(line), f) != NULL)
+	{
+		char name[4] = {0};
+		char data[4] = {0};
+		char *comment = strchr(line, ';');
+		if(comment != NULL)
+			*comment = 0;
+		int fields = sscanf(line, "%3s %3s", name, data);
+		if(fields < 1)
+			continue;
+
+		char *end = line + strlen(line);
+		while(end > line && isspace((unsigned char)end[-1]))
+			end--;
+		uint16_t editingKeys = strspn(line, "^.,]") == (size_t)(end - line) ? end - line : 0;
+		if(keyCount + 8 + editingKeys > SIMKEYBOARD_MAX_KEYS)
+		{
+			fclose(f);
+			return -1;
+		}
+
+		if(editingKeys > 0)
+		{
+			memcpy(&keys[keyCount], line, editingKeys);
+			keyCount += editingKeys;
+			continue;
+		}
+
+		if(strcmp(name, "#") == 0)
+		{
+			keys[keyCount++] = PS2_KEY_F2;
+			continue;
+		}
+
+		for(uint8_t i = 0; name[i] != 0; i++)
+			keys[keyCount++] = toupper((unsigned char)name[i]);
+		if(fields == 2)
+		{
+			keys[keyCount++] = ' ';
+			for(uint8_t i = 0; data[i] != 0; i++)
+				keys[keyCount++] = toupper((unsigned char)data[i]);
+		}
+		keys[keyCount++] = ']';
+		instructions++;
+	}
+	fclose(f);
+	return instructions;
+}
+
+//Documented in .h
+int SimKeyboard_WriteOldLayout(uint8_t *eeprom, uint16_t size)
+{
+	int instructions = 0;
+	for(uint16_t key = 0; key < keyCount;)
+	{
+		//Every instruction has been loaded as its name, a space and its data followed by Enter
+		uint16_t end = key;
+		while(end < keyCount && keys[end] != ']')
+			end++;
+		if(end == keyCount || end - key < 3 || end - key > 7 || (instructions + 1) * sizeof(Instruction) > size)
+			return -1;
+
+		Instruction in = {0};
+		in.functionNumber = Function_t_MAX;
+		for(uint8_t i = 0; i < Function_t_MAX; i++)
+		{
+			if(memcmp(&keys[key], definedFunctions[i].name, 3) == 0)
+				in.functionNumber = i;
+		}
+		if(in.functionNumber == Function_t_MAX)
+			return -1;
+
+		for(uint8_t i = 4; key + i < end; i++)
+			(&in.data)[i - 4] = keys[key + i];
+		memcpy(&eeprom[instructions * sizeof(Instruction)], &in, sizeof(in));
+		instructions++;
+		key = end + 1;
+	}
+
+	keyCount = 0;
+	nextKey = 0;
+	return instructions;
+}
+
+//Documented in PS2Driver.h
+char PS2_GetKey()
+{
+	//Typing takes some time, which also lets the display updates of the previous key finish
+	HAL_Delay(1);
+
+	if(nextKey >= keyCount)
+	{
+		SimHAL_SetModeSwitch(false);
+		return 0;
+	}
+	return keys[nextKey++];
+}
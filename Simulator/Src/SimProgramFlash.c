@@ -0,0 +1,52 @@
+/**
+ * @file SimProgramFlash.c
+ * @brief Replaces ProgramFlash.c when building the host simulator
+ * @details The regions are kept in RAM and start erased. Like the flash, a half-word can only be written once after
+ * an erase, and the erased pages are counted, so the simulator can show the wear caused by a program.
+ */
+
+#include <string.h>
+#include "ProgramFlash.h"
+#include "SimHAL.h"
+
+/**
+ * @brief Size of a flash page in bytes
+ */
+#define SIMPROGRAMFLASH_PAGE_SIZE 0x400
+
+/**
+ * @brief Contents of the regions
+ */
+static uint8_t regions[ProgramFlash_Region_t_MAX][PROGRAMFLASH_SIZE] = {[0 ... ProgramFlash_Region_t_MAX - 1] = {[0 ... PROGRAMFLASH_SIZE - 1] = 0xFF}};
+
+//Documented in SimHAL.h
+uint32_t simFlashErases = 0;
+
+//Documented in ProgramFlash.h
+const void* ProgramFlash_GetRegion(ProgramFlash_Region_t region)
+{
+	return regions[region];
+}
+
+//Documented in ProgramFlash.h
+bool ProgramFlash_Erase(ProgramFlash_Region_t region)
+{
+	memset(regions[region], 0xFF, PROGRAMFLASH_SIZE);
+	simFlashErases += PROGRAMFLASH_SIZE / SIMPROGRAMFLASH_PAGE_SIZE;
+	return true;
+}
+
+//Documented in ProgramFlash.h
+bool ProgramFlash_Write(ProgramFlash_Region_t region, uint16_t offset, const void *data, uint16_t size)
+{
+	const uint8_t *bytes = data;
+	uint8_t *flash = regions[region];
+	for(uint16_t i = 0; i + 1 < size; i += 2)
+	{
+		if(offset + i + 1 >= PROGRAMFLASH_SIZE || flash[offset + i] != 0xFF || flash[offset + i + 1] != 0xFF)
+			return false;
+		flash[offset + i] = bytes[i];
+		flash[offset + i + 1] = bytes[i + 1];
+	}
+	return true;
+}
@@ -0,0 +1,365 @@
+/**
+ * @file SimThumb.c
+ * @brief Replaces Thumb.c when building the host simulator
+ * @details The translated code is executed by an emulator of the Thumb instructions generated by NativeCode.c in a
+ * small 32-bit address space: the NATIVE flash region, the helpers (which are called on the host), the state, the
+ * registers, the mode flag and a stack. An instruction or an address outside of it ends the simulation with an error,
+ * so a wrong translation shows up as a failed comparison with the interpreter.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "InstructionHandlers.h"
+#include "ProgramFlash.h"
+#include "STM_FUNCTIONS.h"
+#include "Thumb.h"
+
+/**
+ * @name Addresses seen by the translated code
+ * @{
+ */
+#define SIMTHUMB_HELPERS	0x08000100	///< First helper, the following ones are 4 bytes apart
+#define SIMTHUMB_CODE		0x08006000	///< Start of the NATIVE region (as on the device)
+#define SIMTHUMB_STATE		0x20000000	///< The Thumb_State
+#define SIMTHUMB_REGISTERS	0x20000100	///< The registers of the program
+#define SIMTHUMB_MODE		0x20000200	///< The mode flag
+#define SIMTHUMB_STACK		0x20000300	///< Lowest address of the stack
+#define SIMTHUMB_RETURN		0xFFFFFFFE	///< Return address passed to the prologue (ends the emulation)
+/** @} */
+
+/**
+ * @brief Size of the stack in bytes
+ */
+#define SIMTHUMB_STACK_SIZE 0x100
+
+/**
+ * @brief Indices of the registers with special functions
+ */
+enum { SIMTHUMB_SP = 13, SIMTHUMB_LR = 14, SIMTHUMB_PC = 15 };
+
+/**
+ * @brief Registers of the CPU
+ */
+static uint32_t r[16];
+
+/**
+ * @brief Flags of the CPU (negative, zero, carry, overflow)
+ */
+static bool n, z, c, v;
+
+/**
+ * @brief Memory holding the state while the code runs
+ */
+static Thumb_State stateMemory;
+
+/**
+ * @brief Memory of the stack
+ */
+static uint8_t stack[SIMTHUMB_STACK_SIZE];
+
+/**
+  * @brief Ends the simulation because the code did something the emulator doesn't know
+  * @param message Description of the problem
+  * @param value Instruction or address causing the problem
+  */
+static void SimThumb_Fail(const char *message, uint32_t value)
+{
+	fprintf(stderr, "Translated code: %s %08X at %08X\n", message, value, r[SIMTHUMB_PC]);
+	exit(1);
+}
+
+/**
+  * @brief Maps an address of the translated code to the memory of the host
+  * @param address The address
+  * @param size Number of bytes accessed
+  * @param write true if the memory is written (the flash is read-only)
+  * @return The memory of the host (ends the simulation if the address is invalid)
+  */
+static volatile uint8_t* SimThumb_Map(uint32_t address, uint8_t size, bool write)
+{
+	if(address % size != 0)
+		SimThumb_Fail("unaligned access to", address);
+
+	if(!write && address >= SIMTHUMB_CODE && address + size <= SIMTHUMB_CODE + PROGRAMFLASH_SIZE)
+		return (uint8_t*)ProgramFlash_GetRegion(PROGRAMFLASH_NATIVE) + (address - SIMTHUMB_CODE);
+	if(address >= SIMTHUMB_STATE && address + size <= SIMTHUMB_STATE + sizeof(stateMemory))
+		return (uint8_t*)&stateMemory + (address - SIMTHUMB_STATE);
+	if(address >= SIMTHUMB_REGISTERS && address + size <= SIMTHUMB_REGISTERS + 100 * sizeof(uint16_t))
+		return (uint8_t*)InstructionHandlers_GetRegisters() + (address - SIMTHUMB_REGISTERS);
+	if(!write && address == SIMTHUMB_MODE && size == 1)
+		return (volatile uint8_t*)&programmingMode;
+	if(address >= SIMTHUMB_STACK && address + size <= SIMTHUMB_STACK + SIMTHUMB_STACK_SIZE)
+		return stack + (address - SIMTHUMB_STACK);
+
+	SimThumb_Fail("invalid access to", address);
+	return NULL;
+}
+
+/**
+  * @brief Reads from the memory of the translated code (little endian like the Cortex-M0)
+  * @param address The address
+  * @param size Number of bytes (1, 2 or 4)
+  */
+static uint32_t SimThumb_Read(uint32_t address, uint8_t size)
+{
+	volatile uint8_t *memory = SimThumb_Map(address, size, false);
+	uint32_t value = 0;
+	for(uint8_t i = 0; i < size; i++)
+	{
+		value |= (uint32_t)memory[i] << (8 * i);
+	}
+	return value;
+}
+
+/**
+  * @brief Writes into the memory of the translated code
+  * @param address The address
+  * @param size Number of bytes (1, 2 or 4)
+  * @param value The value
+  */
+static void SimThumb_Write(uint32_t address, uint8_t size, uint32_t value)
+{
+	volatile uint8_t *memory = SimThumb_Map(address, size, true);
+	for(uint8_t i = 0; i < size; i++)
+	{
+		memory[i] = value >> (8 * i);
+	}
+}
+
+/**
+  * @brief Calculates a + b + carry and sets all flags like ADDS, SUBS and CMP
+  * @return The result
+  */
+static uint32_t SimThumb_AddWithCarry(uint32_t a, uint32_t b, bool carry)
+{
+	uint64_t unsignedSum = (uint64_t)a + b + carry;
+	int64_t signedSum = (int64_t)(int32_t)a + (int32_t)b + carry;
+	uint32_t result = (uint32_t)unsignedSum;
+
+	n = result >> 31;
+	z = result == 0;
+	c = unsignedSum >> 32;
+	v = (int64_t)(int32_t)result != signedSum;
+	return result;
+}
+
+/**
+  * @brief Determines if a condition of a conditional branch is true
+  * @param condition The condition code (0-13)
+  */
+static bool SimThumb_Condition(uint8_t condition)
+{
+	switch(condition)
+	{
+		case 0: return z;
+		case 1: return !z;
+		case 2: return c;
+		case 3: return !c;
+		case 4: return n;
+		case 5: return !n;
+		case 6: return v;
+		case 7: return !v;
+		case 8: return c && !z;
+		case 9: return !c || z;
+		case 10: return n == v;
+		case 11: return n != v;
+		case 12: return !z && n == v;
+		default: return z || n != v;
+	}
+}
+
+/**
+  * @brief Calls a helper on the host with the arguments in r0 and r1 and returns its result in r0
+  * @param address Address of the helper
+  */
+static void SimThumb_CallHelper(uint32_t address)
+{
+	switch((address - SIMTHUMB_HELPERS) / 4 + THUMB_FIRST_HELPER)
+	{
+		case THUMB_ISINPUTHIGH: r[0] = STM_IsInputHigh(r[0]); break;
+		case THUMB_TAKEBUTTONPRESS: r[0] = STM_TakeButtonPress(r[0]); break;
+		case THUMB_READADC: r[0] = STM_ReadADC(r[0]); break;
+		case THUMB_SETLED: STM_SetLED(r[0], r[1]); break;
+		default: SimThumb_Fail("call of unknown helper", address);
+	}
+	//The scratch registers don't survive a call
+	r[1] = r[2] = r[3] = r[12] = 0xDEADBEEF;
+}
+
+/**
+  * @brief Continues the execution at an address (BL, BX or POP into PC)
+  * @param address The address (the lowest bit selects the Thumb state)
+  * @param link Address to return to if the target is a helper
+  */
+static void SimThumb_Branch(uint32_t address, uint32_t link)
+{
+	if(address >= SIMTHUMB_HELPERS && address < SIMTHUMB_HELPERS + 4 * (Thumb_Symbol_t_MAX - THUMB_FIRST_HELPER))
+	{
+		SimThumb_CallHelper(address & ~1u);
+		r[SIMTHUMB_PC] = link;
+		return;
+	}
+	r[SIMTHUMB_PC] = address & ~1u;
+}
+
+/**
+  * @brief Executes the instructions until the prologue returns to SIMTHUMB_RETURN
+  */
+static void SimThumb_Run(void)
+{
+	while(r[SIMTHUMB_PC] != (SIMTHUMB_RETURN & ~1u))
+	{
+		uint32_t pc = r[SIMTHUMB_PC];
+		if(pc < SIMTHUMB_CODE || pc >= SIMTHUMB_CODE + PROGRAMFLASH_SIZE)
+			SimThumb_Fail("execution outside of the code at", pc);
+		uint16_t op = SimThumb_Read(pc, 2);
+		uint8_t rd = op & 7;
+		uint8_t rn = (op >> 3) & 7;
+		uint8_t rm = (op >> 6) & 7;
+		uint8_t imm5 = (op >> 6) & 0x1F;
+		uint8_t rdHigh = (op >> 8) & 7;
+		uint8_t imm8 = op & 0xFF;
+		r[SIMTHUMB_PC] = pc + 2;
+
+		if((op & 0xF800) == 0x0000)
+		{
+			//LSLS (immediate), MOVS (register) if the shift is 0
+			if(imm5 > 0)
+				c = (r[rn] >> (32 - imm5)) & 1;
+			r[rd] = r[rn] << imm5;
+			n = r[rd] >> 31;
+			z = r[rd] == 0;
+		}
+		else if((op & 0xF800) == 0x0800)
+		{
+			//LSRS (immediate), a shift of 0 means 32
+			uint8_t shift = imm5 == 0 ? 32 : imm5;
+			c = (r[rn] >> (shift - 1)) & 1;
+			r[rd] = shift == 32 ? 0 : r[rn] >> shift;
+			n = r[rd] >> 31;
+			z = r[rd] == 0;
+		}
+		else if((op & 0xFE00) == 0x1800)
+			r[rd] = SimThumb_AddWithCarry(r[rn], r[rm], false);
+		else if((op & 0xFE00) == 0x1A00)
+			r[rd] = SimThumb_AddWithCarry(r[rn], ~r[rm], true);
+		else if((op & 0xF800) == 0x2000)
+		{
+			r[rdHigh] = imm8;
+			n = false;
+			z = imm8 == 0;
+		}
+		else if((op & 0xF800) == 0x2800)
+			SimThumb_AddWithCarry(r[rdHigh], ~(uint32_t)imm8, true);
+		else if((op & 0xF800) == 0x3000)
+			r[rdHigh] = SimThumb_AddWithCarry(r[rdHigh], imm8, false);
+		else if((op & 0xF800) == 0x3800)
+			r[rdHigh] = SimThumb_AddWithCarry(r[rdHigh], ~(uint32_t)imm8, true);
+		else if((op & 0xFFC0) == 0x4280)
+			SimThumb_AddWithCarry(r[rd], ~r[rn], true);
+		else if((op & 0xFF87) == 0x4700)
+			SimThumb_Branch(r[(op >> 3) & 0xF], r[SIMTHUMB_PC]);
+		else if((op & 0xFE00) == 0x5200)
+			SimThumb_Write(r[rn] + r[rm], 2, r[rd]);
+		else if((op & 0xFE00) == 0x5A00)
+			r[rd] = SimThumb_Read(r[rn] + r[rm], 2);
+		else if((op & 0xF800) == 0x6000)
+			SimThumb_Write(r[rn] + imm5 * 4, 4, r[rd]);
+		else if((op & 0xF800) == 0x6800)
+			r[rd] = SimThumb_Read(r[rn] + imm5 * 4, 4);
+		else if((op & 0xF800) == 0x7800)
+			r[rd] = SimThumb_Read(r[rn] + imm5, 1);
+		else if((op & 0xF800) == 0x8000)
+			SimThumb_Write(r[rn] + imm5 * 2, 2, r[rd]);
+		else if((op & 0xF800) == 0x8800)
+			r[rd] = SimThumb_Read(r[rn] + imm5 * 2, 2);
+		else if((op & 0xF800) == 0x9800)
+			r[rdHigh] = SimThumb_Read(r[SIMTHUMB_SP] + imm8 * 4, 4);
+		else if((op & 0xFE00) == 0xB400)
+		{
+			//PUSH stores the lowest register at the lowest address
+			uint8_t count = __builtin_popcount(op & 0x1FF);
+			uint32_t address = r[SIMTHUMB_SP] - 4 * count;
+			r[SIMTHUMB_SP] = address;
+			for(uint8_t i = 0; i < 8; i++)
+			{
+				if(op & (1 << i))
+				{
+					SimThumb_Write(address, 4, r[i]);
+					address += 4;
+				}
+			}
+			if(op & 0x100)
+				SimThumb_Write(address, 4, r[SIMTHUMB_LR]);
+		}
+		else if((op & 0xFE00) == 0xBC00)
+		{
+			uint32_t address = r[SIMTHUMB_SP];
+			for(uint8_t i = 0; i < 8; i++)
+			{
+				if(op & (1 << i))
+				{
+					r[i] = SimThumb_Read(address, 4);
+					address += 4;
+				}
+			}
+			if(op & 0x100)
+			{
+				SimThumb_Branch(SimThumb_Read(address, 4), 0);
+				address += 4;
+			}
+			r[SIMTHUMB_SP] = address;
+		}
+		else if((op & 0xF000) == 0xD000 && ((op >> 8) & 0xF) < 14)
+		{
+			if(SimThumb_Condition((op >> 8) & 0xF))
+				r[SIMTHUMB_PC] = pc + 4 + (int8_t)imm8 * 2;
+		}
+		else if((op & 0xF800) == 0xE000)
+			r[SIMTHUMB_PC] = pc + 4 + ((int32_t)((op & 0x7FF) << 21) >> 20);
+		else if((op & 0xF800) == 0xF000)
+		{
+			uint16_t op2 = SimThumb_Read(pc + 2, 2);
+			if((op2 & 0xD000) != 0xD000)
+				SimThumb_Fail("unknown instruction", op << 16 | op2);
+			uint32_t s = (op >> 10) & 1;
+			uint32_t i1 = !(((op2 >> 13) & 1) ^ s);
+			uint32_t i2 = !(((op2 >> 11) & 1) ^ s);
+			int32_t offset = (int32_t)((s << 24 | i1 << 23 | i2 << 22 | (op & 0x3FF) << 12 | (op2 & 0x7FF) << 1) << 7) >> 7;
+			r[SIMTHUMB_LR] = (pc + 4) | 1;
+			SimThumb_Branch(pc + 4 + offset, pc + 4);
+		}
+		else
+			SimThumb_Fail("unknown instruction", op);
+	}
+}
+
+//Documented in Thumb.h
+uint32_t Thumb_GetAddress(Thumb_Symbol_t symbol)
+{
+	switch(symbol)
+	{
+		case THUMB_CODE: return SIMTHUMB_CODE;
+		case THUMB_REGISTERS: return SIMTHUMB_REGISTERS;
+		case THUMB_MODE: return SIMTHUMB_MODE;
+		default: return SIMTHUMB_HELPERS + 4 * (symbol - THUMB_FIRST_HELPER) + 1;
+	}
+}
+
+//Documented in Thumb.h
+uint16_t Thumb_Call(uint16_t prologue, uint16_t entry, Thumb_State *state)
+{
+	//The addresses in the state are the ones seen by the code anyway (see Thumb_GetAddress())
+	stateMemory = *state;
+	r[0] = SIMTHUMB_STATE;
+	r[1] = SIMTHUMB_CODE + entry + 1;
+	r[SIMTHUMB_SP] = SIMTHUMB_STACK + SIMTHUMB_STACK_SIZE;
+	r[SIMTHUMB_LR] = SIMTHUMB_RETURN | 1;
+	r[SIMTHUMB_PC] = SIMTHUMB_CODE + prologue;
+
+	SimThumb_Run();
+
+	*state = stateMemory;
+	return r[0];
+}
@@ -0,0 +1,404 @@
+/**
+ * @file Simulator.c
+ * @brief Runs the interpreter on the host with simulated hardware
+ * @details Usage: PCD_Simulator [-p program] [-e image] [-s script] [-t ms] [-w s] [-b csv] [-o] [-x address] [-d] [-c]
+ * - -p Program text which is typed in before execution (the EEPROM is erased first)
+ * - -e EEPROM image file (4 KB) which is loaded before and saved after the run
+ * - -s Script of timed inputs (see SimHAL_LoadScript())
+ * - -t Simulated time in ms after which the device is switched back into programming mode (default 10000)
+ * - -w Host time in s after which the simulation is stopped (default 60)
+ * - -b Writes the usage of the I2C bus by each caller (see I2CBus.h) to a CSV file
+ * - -o Writes the program into the EEPROM in the layout of older firmware instead of typing it, so it is converted
+ *   when the device starts (see SimKeyboard_WriteOldLayout())
+ * - -x Inverts the byte at an address of the EEPROM after the program has been typed, e.g. to damage a block
+ * - -d Prints all pixels of the display at the end
+ * - -c Executes the program a second time with the handlers only (see NativeCode_SetEnabled()) and compares the
+ *   registers, the display, the LEDs and the number of executed instructions at the end with the ones of the translated
+ *   program (exit code 1 if they differ)
+ *
+ * The simulated time only advances when the firmware accesses the hardware, so programs run at full host speed.
+ * A program waiting for an interrupt in a loop without any hardware access (e.g. after an error) is detected by a
+ * watchdog and ends the simulation.
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "Crc.h"
+#include "Display.h"
+#include "I2CBus.h"
+#include "InstructionCache.h"
+#include "InstructionHandlers.h"
+#include "InstructionList.h"
+#include "NativeCode.h"
+#include "ProgramStore.h"
+#include "Scheduler.h"
+#include "SimHAL.h"
+#include "SimKeyboard.h"
+
+/**
+ * @brief Interval of the watchdog in us
+ */
+#define SIMULATOR_WATCHDOG_US 50000
+
+/**
+ * @brief Host time in s after which the simulation is stopped
+ */
+static unsigned wallLimit = 60;
+
+/**
+ * @brief Host time at which the execution started
+ */
+static struct timespec startTime;
+
+/**
+ * @brief Returns the host time in s since the execution started
+ */
+static double Simulator_GetHostTime(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - startTime.tv_sec) + (now.tv_nsec - startTime.tv_nsec) / 1e9;
+}
+
+/**
+  * @brief Switches the device into programming mode if it made no hardware access since the last call
+  * or if the host time limit has been reached
+  */
+static void Simulator_Watchdog(int signal)
+{
+	static uint32_t lastActivity = 0;
+	uint32_t activity = SimHAL_GetActivity();
+
+	if(activity == lastActivity || Simulator_GetHostTime() >= wallLimit)
+		SimHAL_SetModeSwitch(true);
+	lastActivity = activity;
+}
+
+/**
+  * @brief Starts or stops the watchdog timer
+  * @param run true = start, false = stop
+  */
+static void Simulator_SetWatchdog(bool run)
+{
+	struct itimerval timer = {0};
+	if(run)
+	{
+		signal(SIGALRM, Simulator_Watchdog);
+		timer.it_interval.tv_usec = SIMULATOR_WATCHDOG_US;
+		timer.it_value.tv_usec = SIMULATOR_WATCHDOG_US;
+	}
+	setitimer(ITIMER_REAL, &timer, NULL);
+}
+
+/**
+ * @brief Names of the callers of the I2C bus (in the order of I2CBus_Caller_t)
+ */
+static const char *busCallerNames[I2CBus_Caller_t_MAX] = {"eeprom_read", "eeprom_write", "display_command", "display_data"};
+
+/**
+  * @brief Prints the usage of the I2C bus by each caller
+  * @param f File to print to
+  * @param csv true = CSV format, false = table for the summary
+  */
+static void Simulator_PrintBusStatistics(FILE *f, bool csv)
+{
+	if(csv)
+		fprintf(f, "caller,transactions,bytes,blocking_time_us\n");
+	else
+		fprintf(f, "I2C bus:               caller           transactions      bytes   time [ms]\n");
+
+	for(uint8_t i = 0; i < I2CBus_Caller_t_MAX; i++)
+	{
+		const I2CBus_Statistics *statistics = I2CBus_GetStatistics(i);
+		if(csv)
+			fprintf(f, "%s,%u,%u,%u\n", busCallerNames[i], statistics->transactions, statistics->bytes, statistics->blockingTime);
+		else
+			fprintf(f, "                       %-16s %12u %10u %11.1f\n", busCallerNames[i], statistics->transactions, statistics->bytes, statistics->blockingTime / 1000.0);
+	}
+}
+
+/**
+ * @brief State of the device at the end of a run, which must not depend on the translation of the program
+ */
+typedef struct {
+	/**
+	 * @brief Values of the registers
+	 */
+	uint16_t registers[100];
+
+	/**
+	 * @brief Upper line of the display
+	 */
+	char line1[17];
+
+	/**
+	 * @brief Lower line of the display
+	 */
+	char line2[17];
+
+	/**
+	 * @brief Colours of LD1 and LD2
+	 */
+	char leds[2];
+
+	/**
+	 * @brief State of the buzzer
+	 */
+	bool buzzer;
+
+	/**
+	 * @brief Number of executed instructions (see InstructionList_GetExecutedInstructions())
+	 */
+	uint32_t executed;
+} Simulator_Outcome;
+
+/**
+  * @brief Records the state of the device at the end of a run
+  * @param outcome Receives the state
+  */
+static void Simulator_GetOutcome(Simulator_Outcome *outcome)
+{
+	memset(outcome, 0, sizeof(*outcome));
+	memcpy(outcome->registers, InstructionHandlers_GetRegisters(), sizeof(outcome->registers));
+	SimHAL_GetDisplayText(outcome->line1, outcome->line2);
+	outcome->leds[0] = SimHAL_GetLEDColour(0);
+	outcome->leds[1] = SimHAL_GetLEDColour(1);
+	outcome->buzzer = SimHAL_IsBuzzerOn();
+	outcome->executed = InstructionList_GetExecutedInstructions();
+}
+
+/**
+  * @brief Prints the differences between the runs with and without the translation
+  * @param translated Outcome of the translated program
+  * @param interpreted Outcome of the program executed by the handlers
+  * @return false if there is any difference
+  */
+static bool Simulator_CompareOutcomes(const Simulator_Outcome *translated, const Simulator_Outcome *interpreted)
+{
+	bool same = true;
+	for(uint8_t i = 0; i < 100; i++)
+	{
+		if(translated->registers[i] != interpreted->registers[i])
+		{
+			printf("Interpreter:           R%u = %u instead of %u\n", i, interpreted->registers[i], translated->registers[i]);
+			same = false;
+		}
+	}
+	if(strcmp(translated->line1, interpreted->line1) != 0 || strcmp(translated->line2, interpreted->line2) != 0)
+	{
+		printf("Interpreter:           display [%s] [%s]\n", interpreted->line1, interpreted->line2);
+		same = false;
+	}
+	if(memcmp(translated->leds, interpreted->leds, sizeof(translated->leds)) != 0 || translated->buzzer != interpreted->buzzer)
+	{
+		printf("Interpreter:           LD1/LD2 [%c] [%c], buzzer %s\n", interpreted->leds[0], interpreted->leds[1], interpreted->buzzer ? "on" : "off");
+		same = false;
+	}
+	if(translated->executed != interpreted->executed)
+	{
+		printf("Interpreter:           %u executed instructions instead of %u\n", interpreted->executed, translated->executed);
+		same = false;
+	}
+	if(same)
+		printf("Interpreter:           same registers, display, LEDs and executed instructions\n");
+	return same;
+}
+
+/**
+  * @brief Loads or saves the EEPROM image
+  * @param path Path of the image file
+  * @param save true = save, false = load
+  * @return false if the file could not be accessed
+  */
+static bool Simulator_AccessImage(const char *path, bool save)
+{
+	FILE *f = fopen(path, save ? "wb" : "rb");
+	if(f == NULL)
+		return false;
+
+	if(save)
+		fwrite(simEEPROM, 1, SIMHAL_EEPROM_SIZE, f);
+	else
+		fread(simEEPROM, 1, SIMHAL_EEPROM_SIZE, f);
+	fclose(f);
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *programPath = NULL;
+	const char *imagePath = NULL;
+	const char *scriptPath = NULL;
+	const char *busPath = NULL;
+	uint32_t timeLimit = 10000;
+	bool dump = false;
+	bool compare = false;
+	bool oldLayout = false;
+	long damagedAddress = -1;
+
+	int option;
+	while((option = getopt(argc, argv, "p:e:s:t:w:b:ox:dc")) != -1)
+	{
+		switch(option)
+		{
+			case 'p': programPath = optarg; break;
+			case 'e': imagePath = optarg; break;
+			case 's': scriptPath = optarg; break;
+			case 't': timeLimit = strtoul(optarg, NULL, 10); break;
+			case 'w': wallLimit = strtoul(optarg, NULL, 10); break;
+			case 'b': busPath = optarg; break;
+			case 'o': oldLayout = true; break;
+			case 'x': damagedAddress = strtol(optarg, NULL, 0); break;
+			case 'd': dump = true; break;
+			case 'c': compare = true; break;
+			default:
+				fprintf(stderr, "Usage: %s [-p program] [-e image] [-s script] [-t ms] [-w s] [-b csv] [-o] [-x address] [-d] [-c]\n", argv[0]);
+				return 2;
+		}
+	}
+
+	SimHAL_Init();
+	if(imagePath != NULL && !Simulator_AccessImage(imagePath, false) && programPath == NULL)
+	{
+		fprintf(stderr, "Could not read EEPROM image %s\n", imagePath);
+		return 1;
+	}
+	if(programPath != NULL)
+	{
+		memset(simEEPROM, 0, SIMHAL_EEPROM_SIZE);
+		if(SimKeyboard_LoadProgram(programPath) < 0)
+		{
+			fprintf(stderr, "Could not read program %s\n", programPath);
+			return 1;
+		}
+		if(oldLayout && SimKeyboard_WriteOldLayout(simEEPROM, SIMHAL_EEPROM_SIZE) < 0)
+		{
+			fprintf(stderr, "Could not write program %s in the old layout\n", programPath);
+			return 1;
+		}
+	}
+	if(scriptPath != NULL && !SimHAL_LoadScript(scriptPath))
+	{
+		fprintf(stderr, "Could not read script %s\n", scriptPath);
+		return 1;
+	}
+
+	Display_Init();
+	Crc_Init();
+
+	if(programPath != NULL)
+	{
+		SimHAL_SetModeSwitch(true);
+		InstructionList_ProgrammingMode();
+	}
+	if(damagedAddress >= 0 && damagedAddress < SIMHAL_EEPROM_SIZE)
+	{
+		//The changes still kept in RAM are written first, so they don't cover the damage
+		ProgramStore_Flush();
+		simEEPROM[damagedAddress] ^= 0xFF;
+	}
+	SimHAL_SetModeSwitch(false);
+
+	//The handlers execute the same program from the same state in a child process
+	int results[2];
+	pid_t interpreter = -1;
+	if(compare)
+	{
+		fflush(stdout);
+		if(pipe(results) != 0 || (interpreter = fork()) < 0)
+		{
+			perror("Could not start the interpreter");
+			return 1;
+		}
+		if(interpreter == 0)
+			NativeCode_SetEnabled(false);
+	}
+
+	SimHAL_SetTimeOrigin();
+	uint64_t originUs = SimHAL_GetTimeUs();
+	SimHAL_SetTimeLimit(timeLimit);
+	clock_gettime(CLOCK_MONOTONIC, &startTime);
+	Simulator_SetWatchdog(true);
+
+	InstructionList_ExecutingMode();
+	//The display shows the last changes once the flush running in the background has finished
+	Display_WaitForFlush();
+
+	Simulator_SetWatchdog(false);
+	double hostTime = Simulator_GetHostTime();
+
+	Simulator_Outcome outcome;
+	Simulator_GetOutcome(&outcome);
+	if(interpreter == 0)
+	{
+		bool written = write(results[1], &outcome, sizeof(outcome)) == sizeof(outcome);
+		_exit(written ? 0 : 1);
+	}
+
+	if(imagePath != NULL && !Simulator_AccessImage(imagePath, true))
+		fprintf(stderr, "Could not write EEPROM image %s\n", imagePath);
+
+	char line1[17], line2[17];
+	SimHAL_GetDisplayText(line1, line2);
+	uint32_t executed = InstructionList_GetExecutedInstructions();
+	uint32_t executionTime = InstructionList_GetExecutionTime();
+
+	printf("Executed instructions: %u\n", executed);
+	printf("Execution time:        %u ms (simulated)\n", executionTime);
+	printf("Host time:             %.3f s\n", hostTime);
+	printf("Host speed:            %.0f instructions/s\n", hostTime > 0 ? executed / hostTime : 0);
+	uint32_t sleepTime = Scheduler_GetSleepTime();
+	uint32_t runTime = (SimHAL_GetTimeUs() - originUs) / 1000;
+	printf("Sleep time:            %u ms (%.1f %% of the run)\n", sleepTime, runTime > 0 ? 100.0 * sleepTime / runTime : 0);
+	printf("Wake-ups:              %u (%.0f per s of sleep)\n", Scheduler_GetWakeups(), sleepTime > 0 ? Scheduler_GetWakeups() * 1000.0 / sleepTime : 0);
+	printf("Cache hits/misses:     %u/%u\n", InstructionCache_GetHits(), InstructionCache_GetMisses());
+	printf("Prefetched misses:     %u\n", InstructionCache_GetPrefetchHits());
+	printf("Flash page erases:     %u\n", simFlashErases);
+	printf("Translated code:       %u bytes\n", NativeCode_GetSize());
+	printf("Display:               [%s]\n", line1);
+	printf("                       [%s]\n", line2);
+	printf("LD1/LD2:               [%c] [%c]\n", SimHAL_GetLEDColour(0), SimHAL_GetLEDColour(1));
+	printf("Buzzer:                %s\n", SimHAL_IsBuzzerOn() ? "on" : "off");
+	Simulator_PrintBusStatistics(stdout, false);
+	if(busPath != NULL)
+	{
+		FILE *f = fopen(busPath, "w");
+		if(f == NULL)
+		{
+			fprintf(stderr, "Could not write %s\n", busPath);
+			return 1;
+		}
+		Simulator_PrintBusStatistics(f, true);
+		fclose(f);
+	}
+	if(dump)
+		SimHAL_PrintDisplay();
+
+	if(compare)
+	{
+		Simulator_Outcome interpreted;
+		int status;
+		bool received = read(results[0], &interpreted, sizeof(interpreted)) == sizeof(interpreted);
+		waitpid(interpreter, &status, 0);
+		if(!received)
+		{
+			fprintf(stderr, "The interpreter did not finish\n");
+			return 1;
+		}
+		if(NativeCode_GetSize() == 0)
+		{
+			fprintf(stderr, "The program has not been translated\n");
+			return 1;
+		}
+		if(!Simulator_CompareOutcomes(&outcome, &interpreted))
+			return 1;
+	}
+
+	return 0;
+}